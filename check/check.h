@@ -0,0 +1,36 @@
+#ifndef KITTY_CHECK_H
+#define KITTY_CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+
+/*
+ * The build defines NDEBUG for debug builds, so the checks don't rely on assert
+ */
+#define CHECK(x) do {                                                         \
+  if(!(x)) {                                                                  \
+    std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); \
+    std::exit(1);                                                             \
+  }                                                                           \
+} while(0)
+
+namespace check {
+// Runs a task right away, for futures that don't need a pool
+struct inline_t {
+  template<class Function>
+  int post(Function &&f) {
+    f();
+
+    return 0;
+  }
+};
+
+// Rejects every task
+struct reject_t {
+  template<class Function>
+  int post(Function &&) {
+    return -1;
+  }
+};
+}
+#endif
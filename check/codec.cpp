@@ -0,0 +1,109 @@
+#include <string>
+#include <vector>
+#include <random>
+
+#include <kitty/util/codec.h>
+
+#include "check.h"
+
+// The scalar code is the reference for whichever kernel the cpu gets
+static std::string hex_scalar(const std::vector<std::uint8_t> &data) {
+  std::string hex(util::hex_encoded_size(data.size()), '\0');
+  util::_codec::hex_encode_scalar(data.data(), data.size(), hex.data());
+
+  return hex;
+}
+
+static std::string base64_scalar(const std::vector<std::uint8_t> &data) {
+  std::string base64;
+  base64.reserve(util::base64_encoded_size(data.size()));
+
+  // Whole groups of 3 bytes, the padded tail is done by hand
+  std::size_t x = 0;
+  for(; x + 3 <= data.size(); x += 3) {
+    char group[4];
+    util::_codec::base64_encode_scalar(data.data() + x, 3, group);
+    base64.append(group, 4);
+  }
+
+  std::uint32_t triple = 0;
+  for(std::size_t y = x; y < data.size(); ++y) {
+    triple |= (std::uint32_t)data[y] << (16 - 8 * (y - x));
+  }
+
+  if(data.size() - x == 1) {
+    base64 += util::_codec::BASE64[triple >> 18];
+    base64 += util::_codec::BASE64[(triple >> 12) & 0x3F];
+    base64 += "==";
+  }
+  else if(data.size() - x == 2) {
+    base64 += util::_codec::BASE64[triple >> 18];
+    base64 += util::_codec::BASE64[(triple >> 12) & 0x3F];
+    base64 += util::_codec::BASE64[(triple >> 6) & 0x3F];
+    base64 += '=';
+  }
+
+  return base64;
+}
+
+int main() {
+  // RFC 4648 test vectors
+  const char *plain[]  = { "", "f", "fo", "foo", "foob", "fooba", "foobar" };
+  const char *base64[] = { "", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy" };
+
+  for(int x = 0; x < 7; ++x) {
+    std::string encoded;
+    util::base64_encode(std::string(plain[x]), encoded);
+    CHECK(encoded == base64[x]);
+
+    std::string decoded;
+    CHECK(!util::base64_decode(std::string(base64[x]), decoded));
+    CHECK(decoded == plain[x]);
+  }
+
+  // Padding is optional, lower case hex is accepted
+  std::string decoded;
+  CHECK(!util::base64_decode(std::string("Zm9vYg"), decoded) && decoded == "foob");
+
+  decoded.clear();
+  CHECK(!util::hex_decode(std::string("c0FFee"), decoded) && decoded == "\xC0\xFF\xEE");
+
+  // Malformed input leaves out as it was
+  decoded = "kept";
+  CHECK(util::hex_decode(std::string("abc"), decoded) == -1 && decoded == "kept");
+  CHECK(util::base64_decode(std::string("Zm9v!mFy"), decoded) == -1 && decoded == "kept");
+  CHECK(util::base64_decode(std::string("Zm9vY"), decoded) == -1 && decoded == "kept");
+
+  // Long enough for every kernel, with a bad character at each offset of a block
+  std::mt19937 rng(5);
+  for(std::size_t size = 0; size < 300; ++size) {
+    std::vector<std::uint8_t> data(size);
+    for(auto &byte : data) {
+      byte = rng();
+    }
+
+    std::string hex;
+    util::hex_encode(data, hex);
+    CHECK(hex == hex_scalar(data));
+
+    std::string encoded;
+    util::base64_encode(data, encoded);
+    CHECK(encoded == base64_scalar(data));
+
+    std::vector<std::uint8_t> back;
+    CHECK(!util::hex_decode(hex, back) && back == data);
+
+    back.clear();
+    CHECK(!util::base64_decode(encoded, back) && back == data);
+
+    if(size) {
+      hex[rng() % hex.size()] = 'g';
+      CHECK(util::hex_decode(hex, back) == -1);
+
+      encoded[rng() % (size * 4 / 3)] = '*';
+      CHECK(util::base64_decode(encoded, back) == -1);
+    }
+  }
+
+  return 0;
+}
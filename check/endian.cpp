@@ -0,0 +1,68 @@
+#include <random>
+#include <vector>
+#include <cstring>
+
+#include <kitty/util/endian.h>
+
+#include "check.h"
+
+struct __attribute__((packed)) sample_t {
+  std::uint16_t channel;
+  std::uint32_t value;
+  std::uint8_t flags;
+};
+
+struct __attribute__((packed)) wide_t {
+  std::uint64_t a;
+  std::uint64_t b;
+  std::uint16_t c;
+};
+
+template<> struct util::endian::layout<sample_t> : util::endian::fields<2, 4, 1> {};
+template<> struct util::endian::layout<wide_t> : util::endian::fields<8, 8, 2> {};
+
+// Both forms of swap_n against the scalar code, for every length around the lane sizes
+template<class T>
+void check_swap(std::size_t count) {
+  std::mt19937_64 rng(count);
+
+  std::vector<T> in(count), out(count), expected(count);
+
+  auto bytes = (std::uint8_t *)in.data();
+  for(std::size_t x = 0; x < count * sizeof(T); ++x) {
+    bytes[x] = rng();
+  }
+
+  util::endian::_endian::swap_scalar(in.data(), count, expected.data());
+
+  util::endian::swap_n((const T *)in.data(), count, out.data());
+  CHECK(!std::memcmp(out.data(), expected.data(), count * sizeof(T)));
+
+  out = in;
+  util::endian::swap_n(out.data(), count);
+  CHECK(!std::memcmp(out.data(), expected.data(), count * sizeof(T)));
+}
+
+int main() {
+  for(std::size_t count = 0; count < 200; ++count) {
+    check_swap<std::uint8_t>(count);
+    check_swap<std::uint16_t>(count);
+    check_swap<std::uint32_t>(count);
+    check_swap<std::uint64_t>(count);
+    check_swap<double>(count);
+    check_swap<sample_t>(count);
+    check_swap<wide_t>(count);
+  }
+
+  // The scalar code itself swaps each field of a packed struct
+  sample_t sample { 0x0102, 0x03040506, 7 };
+  util::endian::_endian::swap_scalar(&sample, 1, &sample);
+  CHECK(sample.channel == 0x0201 && sample.value == 0x06050403 && sample.flags == 7);
+
+  // big_n is a no-op on big endian machines only
+  std::uint32_t word = 0x01020304;
+  util::endian::big_n(&word, 1);
+  CHECK(word == (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ ? 0x01020304u : 0x04030201u));
+
+  return 0;
+}
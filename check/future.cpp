@@ -0,0 +1,77 @@
+#include <string>
+#include <vector>
+#include <future>
+#include <stdexcept>
+
+#include <kitty/util/thread_pool.h>
+#include <kitty/util/future.h>
+
+#include "check.h"
+
+// @return The message of the exception future fails with, empty if it doesn't fail
+template<class Future>
+std::string error_of(Future &&future) {
+  try {
+    future.get();
+  } catch(const std::exception &e) {
+    return e.what();
+  }
+
+  return {};
+}
+
+int main() {
+  util::ThreadPool pool(2);
+  check::inline_t now;
+  check::reject_t reject;
+
+  // Continuations run on the pool and pass their results on
+  auto length = util::async(pool, [](const std::string &str) { return str + " world"; }, std::string("hello"))
+    .then(pool, [](std::string str) { return str.size(); });
+  CHECK(length.get() == 11);
+
+  // An exception skips the continuations and reaches get()
+  bool skipped = true;
+  auto failed = util::async(pool, []() -> int { throw std::runtime_error("boom"); })
+    .then(now, [&](int) { skipped = false; });
+  CHECK(error_of(failed) == "boom");
+  CHECK(skipped);
+
+  // A rejected task fails its future instead of leaving it pending
+  CHECK(!error_of(util::async(reject, []() { return 1; })).empty());
+  CHECK(!error_of(util::make_ready_future(1).then(reject, [](int x) { return x; })).empty());
+
+  // when_all keeps the order of its futures
+  std::vector<util::Future<int>> futures;
+  for(int x = 0; x < 16; ++x) {
+    futures.emplace_back(util::async(pool, [x]() { return x * x; }));
+  }
+
+  auto squares = util::when_all(std::move(futures)).get();
+  CHECK(squares.size() == 16);
+  for(int x = 0; x < 16; ++x) {
+    CHECK(squares[x] == x * x);
+  }
+
+  CHECK(util::when_all(std::vector<util::Future<void>> {}).valid());
+
+  // when_any reports the future that was ready first
+  util::Promise<int> never;
+  std::vector<util::Future<int>> any;
+  any.emplace_back(never.get_future());
+  any.emplace_back(util::make_ready_future(7));
+
+  auto first = util::when_any(std::move(any)).get();
+  CHECK(first.first == 1 && first.second == 7);
+
+  never.set_value(0);
+
+  // Futures without state are rejected rather than dereferenced
+  std::vector<util::Future<int>> invalid(2);
+  invalid[0] = util::make_ready_future(1);
+
+  CHECK(error_of(util::when_all(invalid)) == std::future_error(std::future_errc::no_state).what());
+  CHECK(error_of(util::when_any(invalid)) == std::future_error(std::future_errc::no_state).what());
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+
+#include <kitty/util/thread_pool.h>
+#include <kitty/util/task_graph.h>
+
+#include "check.h"
+
+int main() {
+  util::ThreadPool pool(4);
+
+  // A diamond: every task runs after all of its dependencies
+  {
+    std::mutex lock;
+    std::vector<int> order;
+
+    auto log = [&](int x) {
+      return [&, x]() {
+        std::lock_guard<std::mutex> lg(lock);
+        order.push_back(x);
+      };
+    };
+
+    util::TaskGraph graph;
+    auto a = graph.add(log(0));
+    auto b = graph.add(log(1), { a });
+    auto c = graph.add(log(2), { a });
+    graph.add(log(3), { b, c });
+
+    CHECK(graph.add(log(4), { 10 }) == (util::TaskGraph::node_t)-1);
+    CHECK(graph.size() == 4);
+
+    // The graph may be run again
+    for(int run = 0; run < 2; ++run) {
+      order.clear();
+      graph.run(pool).get();
+
+      CHECK(order.size() == 4);
+      CHECK(order.front() == 0 && order.back() == 3);
+    }
+  }
+
+  // A failed task skips its dependents, the others still run
+  {
+    std::atomic<int> ran { 0 };
+
+    util::TaskGraph graph;
+    auto bad = graph.add([]() { throw std::runtime_error("boom"); });
+    graph.add([&]() { ++ran; }, { bad });
+    graph.add([&]() { ++ran; });
+
+    bool failed = false;
+    try {
+      graph.run(pool).get();
+    } catch(const std::runtime_error &) {
+      failed = true;
+    }
+
+    CHECK(failed);
+    CHECK(ran == 1);
+  }
+
+  // A long chain behind a failure is skipped without recursing
+  {
+    util::TaskGraph graph;
+    auto node = graph.add([]() { throw std::runtime_error("boom"); });
+    for(int x = 0; x < 100000; ++x) {
+      node = graph.add([]() {}, { node });
+    }
+
+    bool failed = false;
+    try {
+      graph.run(pool).get();
+    } catch(const std::runtime_error &) {
+      failed = true;
+    }
+
+    CHECK(failed);
+  }
+
+  // An empty graph is done right away
+  util::TaskGraph().run(pool).get();
+
+  return 0;
+}
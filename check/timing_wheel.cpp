@@ -0,0 +1,74 @@
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <kitty/util/timing_wheel.h>
+
+#include "check.h"
+
+typedef util::TimingWheel<int> wheel_t;
+
+int main() {
+  std::mt19937_64 rng(1);
+
+  // Deadlines within the first level, across the levels and beyond SPAN
+  for(wheel_t::tick_t span : { 100ull, 300000ull, 40000000ull }) {
+    wheel_t wheel(rng() % 100000);
+
+    std::vector<std::unique_ptr<wheel_t::entry_t>> entries;
+    std::map<int, wheel_t::tick_t> deadlines;
+
+    for(int x = 0; x < 2000; ++x) {
+      entries.emplace_back(std::make_unique<wheel_t::entry_t>(x));
+
+      auto expires = wheel.now() + rng() % span;
+      wheel.arm(*entries.back(), expires);
+      deadlines[x] = std::max(expires, wheel.now() + 1);
+    }
+
+    while(wheel.size()) {
+      auto target = wheel.now() + std::min<wheel_t::tick_t>(wheel.next(), 1 + rng() % 5000);
+
+      wheel.advance(target, [&](wheel_t::entry_t &entry) {
+        // Every entry expires on the tick it was armed for
+        CHECK(deadlines.count(entry.data));
+        CHECK(deadlines[entry.data] == wheel.now());
+        deadlines.erase(entry.data);
+
+        // Entries may be re-armed and cancelled while expiring
+        if(entry.data % 7 == 0 && rng() % 2) {
+          auto expires = wheel.now() + rng() % 1000;
+
+          wheel.arm(entry, expires);
+          deadlines[entry.data] = std::max(expires, wheel.now() + 1);
+        }
+
+        auto &other = *entries[rng() % entries.size()];
+        if(&other != &entry && other.armed() && rng() % 10 == 0) {
+          wheel.cancel(other);
+          deadlines.erase(other.data);
+        }
+      });
+
+      // next() never skips past a deadline
+      for(auto &deadline : deadlines) {
+        CHECK(deadline.second > wheel.now());
+      }
+    }
+
+    CHECK(deadlines.empty());
+  }
+
+  // An entry cancels itself when it's destroyed
+  wheel_t wheel;
+  {
+    wheel_t::entry_t entry(1);
+    wheel.arm(entry, 10);
+    CHECK(wheel.size() == 1);
+  }
+  CHECK(!wheel.size());
+  CHECK(wheel.next() == std::numeric_limits<wheel_t::tick_t>::max());
+
+  return 0;
+}
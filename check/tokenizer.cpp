@@ -0,0 +1,55 @@
+#include <string>
+#include <vector>
+#include <string_view>
+
+#include <kitty/util/tokenizer.h>
+
+#include "check.h"
+
+int main() {
+  // Empty pieces are skipped
+  std::vector<std::string_view> words;
+  CHECK(util::split_into(",a,,b,", ',', words) == 2);
+  CHECK(words[0] == "a" && words[1] == "b");
+
+  // More delimiters than fit the SIMD compare fall back to the table, both must agree
+  std::string text;
+  for(int x = 0; x < 200; ++x) {
+    text += "word";
+    text += " \t\r\n;:,."[x % 8];
+  }
+
+  std::vector<std::string_view> few, many;
+  util::split_into(text, util::any_of(" \t\r\n;:,."), few);
+  util::split_into(text, util::any_of(" \t\r\n;:,.!?#$%&()*+-/<=>@[]^_{|}~"), many);
+  CHECK(few.size() == 200 && few == many);
+
+  // Owned pieces reuse the strings already there
+  std::vector<std::string> owned(5, std::string(64, 'x'));
+  CHECK(util::split_into("a b", ' ', owned) == 2);
+  CHECK(owned.size() == 2 && owned[1] == "b");
+
+  // next() hands out the tail, next_terminated() leaves it for more input
+  std::string_view request = "GET / HTTP/1.1\r\nHost: x\r\n\r\nAccept: te";
+
+  auto lines = util::tokenize(request, util::any_of("\r\n"));
+  std::vector<std::string_view> complete;
+  while(auto line = lines.next_terminated()) {
+    complete.push_back(*line);
+  }
+
+  CHECK(complete.size() == 2 && complete[1] == "Host: x");
+  CHECK(lines.rest() == "Accept: te");
+
+  CHECK(lines.next() == std::string_view("Accept: te"));
+  CHECK(!lines.next() && lines.rest().empty());
+
+  auto iterated = 0;
+  for(auto piece : util::tokenize(request, util::any_of("\r\n"))) {
+    CHECK(!piece.empty());
+    ++iterated;
+  }
+  CHECK(iterated == 3);
+
+  return 0;
+}
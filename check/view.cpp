@@ -0,0 +1,53 @@
+#include <list>
+#include <string>
+#include <vector>
+#include <numeric>
+
+#include <kitty/util/view.h>
+
+#include "check.h"
+
+int main() {
+  std::vector<int> numbers(100);
+  std::iota(std::begin(numbers), std::end(numbers), 0);
+
+  // Elements are read one at a time, take() stops reading once it has enough
+  int reads = 0;
+  auto even = util::view::from(numbers)
+    .map([&](int x) { ++reads; return x * 2; })
+    .filter([](int x) { return x % 3 == 0; })
+    .take(5)
+    .to_vector();
+
+  CHECK((even == std::vector<int> { 0, 6, 12, 18, 24 }));
+  CHECK(reads == 13);
+
+  auto chunks = util::view::from(numbers).take(10).chunk(4).to_vector();
+  CHECK(chunks.size() == 3);
+  CHECK(chunks[1].front() == 4 && chunks[2].size() == 2);
+
+  auto first = util::view::from(numbers).chunk(10).take(2).to_vector();
+  CHECK(first.size() == 2 && first[1].back() == 19);
+
+  std::list<std::string> head { "a", "b" };
+  std::vector<std::string> tail { "c" };
+
+  auto doubled = util::view::concat(util::view::from(head), util::view::from(tail))
+    .map([](const std::string &str) { return str + str; })
+    .to_vector();
+  CHECK((doubled == std::vector<std::string> { "aa", "bb", "cc" }));
+
+  CHECK(util::view::from(head).concat(util::view::from(tail)).take(0).to_vector().empty());
+
+  auto small = util::view::from(numbers).filter([](int x) { return x < 3; }).collect<std::list<int>>();
+  CHECK(small.size() == 3);
+
+  int sum = 0;
+  util::view::from(numbers).for_each([&](int x) { sum += x; });
+  CHECK(sum == 4950);
+
+  CHECK(*util::view::from(numbers).map([](int x) { return x; }).take(7).size_hint() == 7);
+  CHECK(!util::view::from(numbers).filter([](int) { return true; }).size_hint());
+
+  return 0;
+}
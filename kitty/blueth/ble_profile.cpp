@@ -1,6 +1,7 @@
 #include <kitty/blueth/ble.h>
 #include <kitty/blueth/blue_client.h>
 #include <kitty/util/utility.h>
+#include <kitty/util/codec.h>
 #include <kitty/log/log.h>
 
 namespace bt {
@@ -630,24 +631,14 @@ std::vector<uint8_t> Profile::_mtu(server::BlueClient &client) const {
 
 void print_request(uint8_t requestType, std::vector<uint8_t> &request) {
   std::string req_str { "Request: " };
-  for (auto & ch : request) {
-    for (auto & hex_ch : util::hex(ch)) {
-      req_str.push_back(hex_ch);
-    }
-    req_str.push_back(' ');
-  }
+  util::hex_encode(request, req_str);
 
   DEBUG_LOG(req_str);
 }
 
 void print_response(std::vector<uint8_t> &response) {
   std::string resp_str { "Response: " };
-  for (auto & ch : response) {
-    for (auto & hex_ch : util::hex(ch)) {
-      resp_str.push_back(hex_ch);
-    }
-    resp_str.push_back(' ');
-  }
+  util::hex_encode(response, resp_str);
 
   DEBUG_LOG(resp_str);
 }
@@ -9,12 +9,12 @@
 
 namespace server {
 template<>
-util::Optional<bluetooth::Client> bluetooth::_accept() {
+util::Optional<bluetooth::Client> bluetooth::_accept(int listenfd, int flags) {
   Client::_sockaddr client_addr;
 
   socklen_t addr_size = sizeof(client_addr);
   
-  int client_fd = accept(_listenfd.fd, (sockaddr *) &client_addr, &addr_size);
+  int client_fd = _server::accept(listenfd, (sockaddr *) &client_addr, &addr_size, flags);
 
   if (client_fd < 0) {
     return {};
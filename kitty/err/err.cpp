@@ -90,6 +90,12 @@ const char *current() {
       return "BREAK";
     case UNAUTHORIZED:
       return "unauthorized";
+    case OVERLOADED:
+      return "Overloaded";
+    case INVALID_INPUT:
+      return "Invalid input";
+    case WOULD_BLOCK:
+      return "Operation would block";
     case LIB_USER:
       // Special exception: error_code is returned to the caller,
       // the caller must set the error message
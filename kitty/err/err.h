@@ -18,6 +18,9 @@ typedef enum {
   OUT_OF_BOUNDS,
   INPUT_OUTPUT,
   UNAUTHORIZED,
+  OVERLOADED,
+  INVALID_INPUT,
+  WOULD_BLOCK, // A non-blocking file has nothing to read or no room to write
   LIB_USER,
   LIB_SYS,
   LIB_SSL
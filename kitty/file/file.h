@@ -26,6 +26,7 @@
 #include <kitty/err/err.h>
 #include <kitty/util/optional.h>
 #include <kitty/util/template_helper.h>
+#include <kitty/util/buffer_pool.h>
 
 namespace file {
 template<class T>
@@ -42,37 +43,162 @@ raw_t<T> raw(const T& val) {
   };
 }
 
+/*
+ * The cache is borrowed from util::buffer_pool while data is pending,
+ * an idle FD holds no memory.
+ */
 struct buffer_t {
   std::vector<uint8_t> cache;
-  std::vector<uint8_t>::size_type data_p;
+  std::vector<uint8_t>::size_type data_p = 0;
+
+  // Whether cache came from the pool
+  bool borrowed = false;
+
+  buffer_t() = default;
+
+  buffer_t(buffer_t &&other) noexcept : cache(std::move(other.cache)), data_p(other.data_p), borrowed(other.borrowed) {
+    other.cache.clear();
+    other.data_p = 0;
+    other.borrowed = false;
+  }
+
+  buffer_t &operator=(buffer_t &&other) noexcept {
+    std::swap(cache, other.cache);
+    std::swap(data_p, other.data_p);
+    std::swap(borrowed, other.borrowed);
+
+    return *this;
+  }
+
+  void borrow(std::vector<uint8_t>::size_type size) {
+    if(cache.capacity() < size) {
+      release();
+
+      cache = util::buffer_pool::acquire(size);
+      borrowed = true;
+    }
+  }
+
+  void release() {
+    if(borrowed) {
+      util::buffer_pool::release(std::move(cache));
+    }
+    else {
+      cache = std::vector<uint8_t>();
+    }
+
+    data_p = 0;
+    borrowed = false;
+  }
+};
+
+namespace stream {
+namespace _traits {
+template<class Stream, class = void>
+struct readable : std::false_type {};
+
+template<class Stream>
+struct readable<Stream, std::void_t<decltype(std::declval<Stream&>().read(std::declval<std::vector<uint8_t>&>()))>> : std::true_type {};
+
+template<class Stream, class = void>
+struct writable : std::false_type {};
+
+template<class Stream>
+struct writable<Stream, std::void_t<decltype(std::declval<Stream&>().write(std::declval<std::vector<uint8_t>&>()))>> : std::true_type {};
+
+template<class Stream, class = void>
+struct pollable : std::false_type {};
+
+template<class Stream>
+struct pollable<Stream, std::void_t<decltype(std::declval<Stream&>().fd())>> : std::true_type {};
+
+template<class Stream, class = void>
+struct zerocopy : std::false_type {};
+
+template<class Stream>
+struct zerocopy<Stream, std::void_t<decltype(std::declval<Stream&>().write(std::declval<buffer_t&&>()))>> : std::true_type {};
+
+template<class Stream, class = void>
+struct timeout : std::true_type {};
+
+template<class Stream>
+struct timeout<Stream, std::void_t<decltype(Stream::timeout)>> : std::integral_constant<bool, Stream::timeout> {};
+}
+
+/*
+ * What FD can do with a stream, derived from the members the stream has:
+ *   readable: int read(std::vector<uint8_t> &buf);
+ *   writable: int write(std::vector<uint8_t> &buf);
+ *   pollable: int fd();
+ *   timeout:  pollable, unless the stream declares static constexpr bool timeout = false;
+ *   zerocopy: int write(buffer_t &&buf); bool zerocopy(std::size_t size); int flush();
+ *             The stream keeps buf until the kernel is done with it,
+ *             flush() sends what an earlier write couldn't.
+ *
+ * FD leaves out the caches and timeout of what a stream can't do.
+ */
+template<class Stream>
+struct traits {
+  static constexpr bool readable = _traits::readable<Stream>::value;
+  static constexpr bool writable = _traits::writable<Stream>::value;
+  static constexpr bool pollable = _traits::pollable<Stream>::value;
+  static constexpr bool timeout  = pollable && _traits::timeout<Stream>::value;
+  static constexpr bool zerocopy = writable && _traits::zerocopy<Stream>::value;
+};
+}
+
+namespace _fd {
+/*
+ * A member of FD, held as a base so it takes no space when the stream has no use for it.
+ * N keeps the empty bases apart.
+ */
+template<bool Enable, class T, int N>
+struct member_t {
+  T value {};
 };
+
+template<class T, int N>
+struct member_t<false, T, N> {};
+}
+
 /* Represents file in memory, storage or socket */
 template <class Stream>
-class FD { /* File descriptor */
+class FD : /* File descriptor */
+  _fd::member_t<stream::traits<Stream>::timeout,  std::chrono::milliseconds, 0>,
+  _fd::member_t<stream::traits<Stream>::readable, buffer_t, 1>,
+  _fd::member_t<stream::traits<Stream>::writable, buffer_t, 2> {
+public:
+  typedef stream::traits<Stream> traits;
+
+private:
   typedef std::chrono::milliseconds duration_t;
+
+  typedef _fd::member_t<traits::timeout,  duration_t, 0> timeout_t;
+  typedef _fd::member_t<traits::readable, buffer_t, 1>   in_t;
+  typedef _fd::member_t<traits::writable, buffer_t, 2>   out_t;
+
   Stream _stream;
 
   // Change of cacheSize only affects next load
   static constexpr std::vector<uint8_t>::size_type _cacheSize = 1024;
   
-  duration_t _millisec;
-  
+  // Only instantiated for the streams that have them
+  duration_t &_millisec() { return static_cast<timeout_t&>(*this).value; }
 
-  buffer_t _in;
-  buffer_t _out;
+  buffer_t &_in()  { return static_cast<in_t&>(*this).value; }
+  buffer_t &_out() { return static_cast<out_t&>(*this).value; }
 
   static constexpr int READ = 0, WRITE = 1;
 public:
-  FD(FD && other) noexcept : _in(std::move(other._in)), _out(std::move(other._out)) {
+  FD(FD && other) noexcept : timeout_t(other), in_t(std::move(other)), out_t(std::move(other)) {
     _stream = std::move(other._stream);
-    _millisec = other._millisec;
   }
 
   FD& operator=(FD && other) noexcept {
     std::swap(_stream, other._stream);
-    std::swap(_in, other._in);
-    std::swap(_out, other._out);
-    std::swap(_millisec, other._millisec);
+    std::swap<timeout_t>(*this, other);
+    std::swap<in_t>(*this, other);
+    std::swap<out_t>(*this, other);
     
     return *this;
   }
@@ -80,39 +206,87 @@ public:
   FD() = default;
 
   template<class T1, class T2, class... Args>
-  FD(std::chrono::duration<T1,T2> duration, Args && ... params)
-  : _stream(std::forward<Args>(params)...), _millisec(std::chrono::duration_cast<duration_t>(duration)), _in { {}, 0 }, _out { {}, 0 } {}
+  FD(std::chrono::duration<T1,T2> duration, Args && ... params) : _stream(std::forward<Args>(params)...) {
+    // Without timeout support, duration is ignored
+    if constexpr (traits::timeout) {
+      _millisec() = std::chrono::duration_cast<duration_t>(duration);
+    }
+  }
 
-  ~FD() noexcept { seal(); }
+  ~FD() noexcept {
+    seal();
+
+    if constexpr (traits::readable) {
+      _in().release();
+    }
+
+    if constexpr (traits::writable) {
+      _out().release();
+    }
+  }
 
   Stream &getStream() { return _stream; }
 
+  // A duration of 0 disables the timeout, reads and writes then don't wait for the file to be ready
+  template<class T1, class T2>
+  FD &set_timeout(std::chrono::duration<T1,T2> duration) {
+    static_assert(traits::timeout, "The stream of this file::FD has no timeout");
+
+    _millisec() = std::chrono::duration_cast<duration_t>(duration);
+    return *this;
+  }
+
   // Write to file
   int out() {
+    static_assert(traits::writable, "The stream of this file::FD can't write");
+
     if ((_select(WRITE))) {
       // Don't clear cache on timeout
       return -1;
     }
 
+    if constexpr (traits::zerocopy) {
+      // Data held back by an earlier write goes first, then large caches are handed over
+      if(_stream.flush() || (_stream.zerocopy(_out().cache.size()) && _stream.write(std::move(_out())))) {
+        if(err::code != err::WOULD_BLOCK) {
+          write_clear();
+        }
+
+        return -1;
+      }
+
+      // The stream owns the cache until the kernel is done with it, the next append borrows a new one
+      if(_out().cache.empty()) {
+        return err::OK;
+      }
+    }
+
     // On success clear
-    auto size = _stream.write(_out.cache);
+    auto size = _stream.write(_out().cache);
     if (size >= 0) {
       // It's possible not all bytes are written
-      if(size < _out.cache.size()) {
-        _out.cache.erase(std::begin(_out.cache), std::begin(_out.cache) +size);
+      if(size < _out().cache.size()) {
+        _out().cache.erase(std::begin(_out().cache), std::begin(_out().cache) +size);
 
         return out();
       }
 
+      _out().release();
       return err::OK;
     }
 
-    write_clear();
+    // A non-blocking file keeps what it couldn't write yet
+    if(err::code != err::WOULD_BLOCK) {
+      write_clear();
+    }
+
     return -1;
   }
 
   // Useful when fine control is necessary
   util::Optional<uint8_t> next() {
+    static_assert(traits::readable, "The stream of this file::FD can't read");
+
     // Load new _cache if end of buffer is reached
     if (_endOfBuffer()) {
       if (_load(_cacheSize)) {
@@ -121,11 +295,20 @@ public:
     }
 
     // If cache.empty() return '\0'
-    return _in.cache.empty() ? util::Optional<uint8_t>() : util::Optional<uint8_t>(_in.cache[_in.data_p++]);
+    if(_in().cache.empty()) {
+      return util::Optional<uint8_t>();
+    }
+
+    auto byte = _in().cache[_in().data_p++];
+    _releaseDrained();
+
+    return util::Optional<uint8_t>(byte);
   }
 
   template<class Function>
   int eachByte(Function &&f, std::uint64_t max = std::numeric_limits<std::uint64_t>::max()) {
+    static_assert(traits::readable, "The stream of this file::FD can't read");
+
     while(!eof() && max) {
       if(_endOfBuffer()) {
 
@@ -138,43 +321,66 @@ public:
 
       --max;
 
-      if (err::code_t err = f(_in.cache[_in.data_p++])) {
+      if (err::code_t err = f(_in().cache[_in().data_p++])) {
+        _releaseDrained();
+
         // Return FileErr::OK if err_code != FileErr::BREAK
         return err == err::BREAK ? 0 : -1;
       }
     }
 
+    _releaseDrained();
     return err::OK;
   }
 
   template<class T>
   FD &append(T &&container) {
-    AppendFunc<T>::run(_out.cache, std::forward<T>(container));
+    static_assert(traits::writable, "The stream of this file::FD can't write");
+
+    _out().borrow(_cacheSize);
+    AppendFunc<T>::run(_out().cache, std::forward<T>(container));
 
     return *this;
   }
 
   FD &write_clear() {
-    _out.cache.clear();
-    _out.data_p = 0;
+    static_assert(traits::writable, "The stream of this file::FD can't write");
 
+    _out().release();
 
     return *this;
   }
 
   FD &read_clear() {
-    _in.cache.clear();
-    _in.data_p = 0;
+    static_assert(traits::readable, "The stream of this file::FD can't read");
+
+    _in().release();
 
     return *this;
   }
 
   std::vector<uint8_t> &get_read_cache() {
-    return _in.cache;
+    static_assert(traits::readable, "The stream of this file::FD can't read");
+
+    return _in().cache;
   }
 
+  // Borrows a buffer when the cache has none, out() returns it once everything is written
   std::vector<uint8_t> &get_write_cache() {
-    return _out.cache;
+    static_assert(traits::writable, "The stream of this file::FD can't write");
+
+    _out().borrow(_cacheSize);
+
+    return _out().cache;
+  }
+
+  // Wait until a read or write won't block, fails with err::TIMEOUT like they would
+  int wait_readable() {
+    return _select(READ);
+  }
+
+  int wait_writable() {
+    return _select(WRITE);
   }
 
   bool eof() {
@@ -199,7 +405,7 @@ public:
    */
   template<class OutStream>
   int copy(FD<OutStream> &out, std::uint64_t max = std::numeric_limits<std::uint64_t>::max()) {
-    auto &cache = out.get_write_cache();
+    static_assert(traits::readable, "The stream of this file::FD can't read");
 
     while (!eof() && max) {
       if(_endOfBuffer()) {
@@ -210,8 +416,10 @@ public:
         continue;
       }
 
+      // out() hands the write cache back to the pool
+      auto &cache = out.get_write_cache();
       while (!_endOfBuffer()) {
-        cache.push_back(_in.cache[_in.data_p++]);
+        cache.push_back(_in().cache[_in().data_p++]);
 
         if(!max) {
           break;
@@ -220,6 +428,8 @@ public:
         --max;
       }
       
+      _releaseDrained();
+
       if (out.out()) {
         return -1;
       }
@@ -230,8 +440,11 @@ public:
 
 private:
   int _select(const int read) {
-    if(_millisec.count() > 0) {
-      auto dur_micro = (suseconds_t)std::chrono::duration_cast<std::chrono::microseconds>(_millisec).count();
+    if constexpr (!traits::timeout) {
+      return err::OK;
+    }
+    else if(_millisec().count() > 0) {
+      auto dur_micro = (suseconds_t)std::chrono::duration_cast<std::chrono::microseconds>(_millisec()).count();
       timeval tv {
         0,
         dur_micro
@@ -272,17 +485,29 @@ private:
       return -1;
     }
     
-    _in.cache.resize(max_bytes);
+    _in().borrow(max_bytes);
+    _in().cache.resize(max_bytes);
     
-    if(_stream.read(_in.cache) < 0)
+    if(_stream.read(_in().cache) < 0) {
+      _in().release();
       return -1;
+    }
     
-    _in.data_p = 0;
+    _in().data_p = 0;
+    _releaseDrained();
+
     return err::OK;
   }
   
   bool _endOfBuffer() {
-    return _in.data_p == _in.cache.size();
+    return _in().data_p == _in().cache.size();
+  }
+
+  // Hand the read cache back once everything in it is consumed
+  void _releaseDrained() {
+    if(_endOfBuffer()) {
+      _in().release();
+    }
   }
   
   template<class T, class S = void>
@@ -384,6 +609,7 @@ std::optional<std::string> read_string(FD<T> &socket, std::size_t size) {
 template<class T, class X>
 class poll_t {
   static_assert(util::instantiation_of<FD, T>::value, "template parameter T must be an instantiation of file::FD");
+  static_assert(T::traits::pollable, "poll_t needs a stream with fd()");
 public:
   using file_t = T;
   using user_t = X;
@@ -1,6 +1,19 @@
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifdef __linux__
+#include <linux/errqueue.h>
+#endif
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
 
 #include <kitty/file/io_stream.h>
 #include <kitty/file/file.h>
@@ -32,6 +45,191 @@ io ioWriteAppend(const char *file_path) {
 }
 
 namespace stream {
+namespace _io {
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define KITTY_ZEROCOPY 1
+#endif
+
+struct pinned_t {
+  buffer_t buf;
+  std::size_t sent;
+
+  // The ids the kernel gave the sends of buf, and how many of them it hasn't reported yet
+  std::uint32_t first;
+  std::uint32_t last;
+  std::uint32_t outstanding;
+};
+
+struct zerocopy_t {
+  std::size_t threshold;
+
+  // The kernel counts the sends with MSG_ZEROCOPY on a socket, this is the id of the next one
+  std::uint32_t next_id = 0;
+
+  std::deque<pinned_t> pinned;
+
+  std::uint64_t copied = 0;
+};
+
+#ifdef KITTY_ZEROCOPY
+// Read the completions from the error queue of the socket
+static void reap(int fd, zerocopy_t &zerocopy) {
+  while(true) {
+    char control[CMSG_SPACE(sizeof(sock_extended_err)) * 4];
+
+    msghdr msg {};
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+
+    if(recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      break;
+    }
+
+    for(auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if(
+        !(cmsg->cmsg_level == SOL_IP   && cmsg->cmsg_type == IP_RECVERR) &&
+        !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)
+      ) {
+        continue;
+      }
+
+      auto serr = (sock_extended_err *)CMSG_DATA(cmsg);
+      if(serr->ee_errno || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+
+      // The sends with ids [ee_info, ee_data] are done, 2^32 sends before the ids wrap is plenty for a connection
+      std::uint32_t lo = serr->ee_info;
+      std::uint32_t hi = serr->ee_data;
+
+      if(serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        zerocopy.copied += hi - lo + 1;
+      }
+
+      for(auto &pinned : zerocopy.pinned) {
+        if(pinned.outstanding && pinned.first <= hi && lo <= pinned.last) {
+          pinned.outstanding -= std::min(hi, pinned.last) - std::max(lo, pinned.first) + 1;
+        }
+      }
+    }
+  }
+
+  auto &pinned = zerocopy.pinned;
+  for(auto it = std::begin(pinned); it != std::end(pinned);) {
+    if(!it->outstanding && it->sent == it->buf.cache.size()) {
+      it->buf.release();
+      it = pinned.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+/*
+ * Sockets sealed while the kernel still held some of their caches.
+ * They're shut down but stay open until it's done, the completions can't be read once they're closed.
+ */
+struct grave_t {
+  int fd;
+  std::unique_ptr<zerocopy_t> zerocopy;
+};
+
+static std::mutex graves_lock;
+static std::vector<grave_t> graves;
+
+// Lets flush() skip the lock while there are no graves
+static std::atomic<std::size_t> buried { 0 };
+
+// Beyond this many graves, the oldest is reset rather than waited for
+static constexpr std::size_t MAX_GRAVES = 1024;
+
+// Close the graves the kernel is done with, graves_lock must be held
+static void reap_graves_locked() {
+  for(auto it = std::begin(graves); it != std::end(graves);) {
+    reap(it->fd, *it->zerocopy);
+
+    if(it->zerocopy->pinned.empty()) {
+      close(it->fd);
+      it = graves.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  buried.store(graves.size(), std::memory_order_relaxed);
+}
+
+// From any stream that seals and any zero-copy stream that flushes or starts
+static void reap_graves() {
+  if(!buried.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  // Another thread is at it already
+  std::unique_lock<std::mutex> ul(graves_lock, std::try_to_lock);
+  if(!ul) {
+    return;
+  }
+
+  reap_graves_locked();
+}
+
+/*
+ * A peer that stops acking would keep its grave forever.
+ * Resetting the connection discards what the kernel still had to send, it then holds none of the caches.
+ */
+static void abort_grave(grave_t &grave) {
+  linger lin { 1, 0 };
+  setsockopt(grave.fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+
+  close(grave.fd);
+
+  for(auto &pinned : grave.zerocopy->pinned) {
+    pinned.buf.release();
+  }
+}
+
+/*
+ * Before the socket closes, the kernel must be done with the pinned caches.
+ * Reusing them earlier would send whatever they're filled with next.
+ *
+ * @return true when fd went to the graves and must not be closed
+ */
+static bool bury(int fd, std::unique_ptr<zerocopy_t> &zerocopy) {
+  // Unsent data won't be sent anymore
+  for(auto &pinned : zerocopy->pinned) {
+    pinned.sent = pinned.buf.cache.size();
+  }
+
+  reap(fd, *zerocopy);
+  if(zerocopy->pinned.empty()) {
+    return false;
+  }
+
+  // The peer sees the connection end now, the kernel reports the last completions once the data is acked
+  shutdown(fd, SHUT_RDWR);
+
+  std::lock_guard<std::mutex> lg(graves_lock);
+  if(graves.size() >= MAX_GRAVES) {
+    reap_graves_locked();
+  }
+
+  if(graves.size() >= MAX_GRAVES) {
+    abort_grave(graves.front());
+    graves.erase(std::begin(graves));
+  }
+
+  graves.push_back(grave_t { fd, std::move(zerocopy) });
+
+  buried.store(graves.size(), std::memory_order_relaxed);
+
+  return true;
+}
+#endif
+}
+
 io::io() : _eof(false), _fd(-1)  { }
 io::io(int fd) : _eof(false), _fd(fd) {
   if(fd <= 0) {
@@ -39,9 +237,12 @@ io::io(int fd) : _eof(false), _fd(fd) {
   }
 }
 
+io::~io() = default;
+
 io& io::operator=(io&& stream) noexcept {
   std::swap(this->_fd, stream._fd);
   std::swap(this->_eof, stream._eof);
+  std::swap(this->_zerocopy, stream._zerocopy);
 
   return *this;
 }
@@ -50,7 +251,7 @@ int io::read(std::vector<unsigned char> &buf) {
   ssize_t bytes_read;
 
   if((bytes_read = ::read(_fd, buf.data(), buf.size())) < 0) {
-    err::code = err::LIB_SYS;
+    err::code = errno == EAGAIN || errno == EWOULDBLOCK ? err::WOULD_BLOCK : err::LIB_SYS;
     return -1;
   }
   else if(!bytes_read) {
@@ -66,7 +267,7 @@ int io::write(const std::vector<unsigned char> &buf) {
   ssize_t bytes_written = ::write(_fd, buf.data(), buf.size());
 
   if(bytes_written < 0) {
-    err::code = err::LIB_SYS;
+    err::code = errno == EAGAIN || errno == EWOULDBLOCK ? err::WOULD_BLOCK : err::LIB_SYS;
 
     return -1;
   }
@@ -74,8 +275,119 @@ int io::write(const std::vector<unsigned char> &buf) {
   return (int)bytes_written;
 }
 
+int io::set_zerocopy(std::size_t threshold) {
+#ifdef KITTY_ZEROCOPY
+  int on = 1;
+  if(setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on))) {
+    err::code = err::LIB_SYS;
+    return -1;
+  }
+
+  if(!_zerocopy) {
+    _zerocopy = std::make_unique<_io::zerocopy_t>();
+  }
+
+  _io::reap_graves();
+
+  _zerocopy->threshold = std::max<std::size_t>(1, threshold);
+  return 0;
+#else
+  errno = EOPNOTSUPP;
+  err::code = err::LIB_SYS;
+  return -1;
+#endif
+}
+
+bool io::zerocopy(std::size_t size) const {
+  return _zerocopy && size >= _zerocopy->threshold;
+}
+
+int io::write(buffer_t &&buf) {
+  if(!_zerocopy) {
+    err::code = err::INVALID_INPUT;
+    return -1;
+  }
+
+  _zerocopy->pinned.push_back(_io::pinned_t { std::move(buf), 0, 0, 0, 0 });
+
+  return flush();
+}
+
+int io::flush() {
+#ifdef KITTY_ZEROCOPY
+  if(!_zerocopy) {
+    return 0;
+  }
+
+  auto &zerocopy = *_zerocopy;
+  _io::reap(_fd, zerocopy);
+  _io::reap_graves();
+
+  for(auto &pinned : zerocopy.pinned) {
+    auto &cache = pinned.buf.cache;
+
+    while(pinned.sent < cache.size()) {
+      ssize_t bytes_written = ::send(_fd, cache.data() + pinned.sent, cache.size() - pinned.sent, MSG_ZEROCOPY | MSG_NOSIGNAL);
+
+      if(bytes_written < 0) {
+        if(errno == EINTR) {
+          continue;
+        }
+
+        err::code = errno == EAGAIN || errno == EWOULDBLOCK ? err::WOULD_BLOCK : err::LIB_SYS;
+        return -1;
+      }
+
+      // Every send that succeeds gets an id, however few bytes it took
+      if(!pinned.outstanding) {
+        pinned.first = zerocopy.next_id;
+      }
+
+      pinned.last = zerocopy.next_id++;
+      ++pinned.outstanding;
+
+      pinned.sent += bytes_written;
+    }
+  }
+#endif
+
+  return 0;
+}
+
+std::size_t io::pinned() {
+  if(!_zerocopy) {
+    return 0;
+  }
+
+#ifdef KITTY_ZEROCOPY
+  _io::reap(_fd, *_zerocopy);
+#endif
+
+  std::size_t bytes = 0;
+  for(auto &pinned : _zerocopy->pinned) {
+    bytes += pinned.buf.cache.size();
+  }
+
+  return bytes;
+}
+
+std::uint64_t io::copied() const {
+  return _zerocopy ? _zerocopy->copied : 0;
+}
+
 void io::seal() {
-  close(_fd);
+#ifdef KITTY_ZEROCOPY
+  _io::reap_graves();
+
+  if(_zerocopy && _fd != -1 && _io::bury(_fd, _zerocopy)) {
+    _fd = -1;
+  }
+#endif
+
+  if(_fd != -1) {
+    close(_fd);
+  }
+
   _fd = -1;
 }
 
@@ -91,7 +403,7 @@ bool io::eof() const {
   return _eof;
 }
 
-io::io(io &&other) noexcept {
+io::io(io &&other) noexcept : _eof(other._eof), _zerocopy(std::move(other._zerocopy)) {
   _fd = other._fd;
   other._fd = -1;
 }
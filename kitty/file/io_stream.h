@@ -2,16 +2,27 @@
 #define IO_STREAM_H
 
 #include <string>
+#include <memory>
 #include <kitty/file/file.h>
 namespace file {
 namespace stream {
+namespace _io {
+struct zerocopy_t;
+}
+
 class io {
+protected:
   bool _eof;
   int _fd;
 
+private:
+  // Only allocated once zero-copy sends are enabled
+  std::unique_ptr<_io::zerocopy_t> _zerocopy;
+
 public:
   io();
   explicit io(int fd);
+  ~io();
 
   io(io &&) noexcept;
   io& operator =(io&& stream) noexcept;
@@ -19,6 +30,30 @@ public:
   int read(std::vector<unsigned char>& buf);
   int write(const std::vector<unsigned char> &buf);
 
+  /*
+   * Send writes of at least threshold bytes with MSG_ZEROCOPY, the kernel then reads them straight from the cache.
+   * Those caches stay pinned until the kernel reports it's done with them, FD borrows a new one meanwhile.
+   * Worth it for writes of hundreds of KiB and up, on loopback the kernel copies anyway.
+   *
+   * @return -1 if the file isn't a socket or the kernel lacks SO_ZEROCOPY
+   */
+  int set_zerocopy(std::size_t threshold);
+
+  // Whether a write of size bytes is sent with MSG_ZEROCOPY
+  bool zerocopy(std::size_t size) const;
+
+  // Takes buf and sends it with MSG_ZEROCOPY, what couldn't be sent yet is kept for flush()
+  int write(buffer_t &&buf);
+
+  // Send what earlier writes couldn't and release the caches the kernel is done with
+  int flush();
+
+  // Bytes pinned until the kernel is done with them
+  std::size_t pinned();
+
+  // Zero-copy sends the kernel ended up copying
+  std::uint64_t copied() const;
+
   bool is_open() const;
   bool eof() const;
 
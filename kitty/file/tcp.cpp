@@ -1,5 +1,7 @@
 #include <unistd.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 #include <netdb.h>
 #include <cstring>
@@ -7,8 +9,69 @@
 #include <kitty/file/tcp.h>
 #include <kitty/err/err.h>
 
+// BSD and macOS have TCP_NOPUSH instead
+#if !defined(TCP_CORK) && defined(TCP_NOPUSH)
+#define TCP_CORK TCP_NOPUSH
+#endif
+
 namespace file {
-io connect(const char *hostname, const char *port) {
+// Only set options that differ from the kernel default
+static int _set(int fd, int level, int option, int value) {
+  if(!value) {
+    return 0;
+  }
+
+  if(setsockopt(fd, level, option, &value, sizeof(value))) {
+    err::code = err::LIB_SYS;
+    return -1;
+  }
+
+  return 0;
+}
+
+int set_options(int fd, const socket_profile_t &profile) {
+  int result = 0;
+
+  // Keep going, so one unsupported option doesn't cost the others
+  result |= _set(fd, IPPROTO_TCP, TCP_NODELAY, profile.nodelay);
+
+#ifdef TCP_QUICKACK
+  result |= _set(fd, IPPROTO_TCP, TCP_QUICKACK, profile.quickack);
+#endif
+
+  result |= _set(fd, SOL_SOCKET, SO_RCVBUF, profile.rcvbuf);
+  result |= _set(fd, SOL_SOCKET, SO_SNDBUF, profile.sndbuf);
+
+#ifdef TCP_NOTSENT_LOWAT
+  result |= _set(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, profile.notsent_lowat);
+#endif
+
+#ifdef SO_BUSY_POLL
+  result |= _set(fd, SOL_SOCKET, SO_BUSY_POLL, profile.busy_poll);
+#endif
+
+  return result;
+}
+
+int set_listener_options(int fd, const socket_profile_t &profile) {
+  int result = 0;
+
+  // Accepted sockets inherit the buffer sizes, the window scale is negotiated with them
+  result |= _set(fd, SOL_SOCKET, SO_RCVBUF, profile.rcvbuf);
+  result |= _set(fd, SOL_SOCKET, SO_SNDBUF, profile.sndbuf);
+
+#ifdef TCP_DEFER_ACCEPT
+  result |= _set(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, profile.defer_accept);
+#endif
+
+#ifdef TCP_FASTOPEN
+  result |= _set(fd, IPPROTO_TCP, TCP_FASTOPEN, profile.fastopen);
+#endif
+
+  return result;
+}
+
+io connect(const char *hostname, const char *port, const socket_profile_t &profile) {
   constexpr std::chrono::seconds timeout { 0 };
   
   addrinfo hints { 0 };
@@ -23,6 +86,14 @@ io connect(const char *hostname, const char *port) {
   }
   
   io sock { timeout, socket(AF_INET, SOCK_STREAM, 0) };
+
+  // Before connect, the buffer sizes and fast open only take effect during the handshake
+  // Best effort, like on accepted sockets: an unsupported option doesn't cost the connection
+  set_options(sock.getStream().fd(), profile);
+
+#ifdef TCP_FASTOPEN_CONNECT
+  _set(sock.getStream().fd(), IPPROTO_TCP, TCP_FASTOPEN_CONNECT, profile.fastopen ? 1 : 0);
+#endif
   
   if(connect(sock.getStream().fd(), server->ai_addr, server->ai_addrlen)) {
     freeaddrinfo(server);
@@ -35,4 +106,14 @@ io connect(const char *hostname, const char *port) {
   
   return sock;
 }
+
+Cork::Cork(int fd) : _fd(fd) {
+  int on = 1;
+  setsockopt(_fd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on));
+}
+
+Cork::~Cork() {
+  int off = 0;
+  setsockopt(_fd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+}
 }
@@ -4,7 +4,68 @@
 #include <kitty/file/io_stream.h>
 
 namespace file {
-  io connect(const char *hostname, const char *port);
+/*
+ * Socket options applied when a socket is accepted or connected.
+ * 0 and false leave the kernel default alone, so the default profile costs no system calls.
+ */
+struct socket_profile_t {
+  // Send small writes right away instead of holding them until earlier data is acknowledged (Nagle)
+  bool nodelay = false;
+
+  // Acknowledge right away, the kernel may fall back to delayed acks later on
+  bool quickack = false;
+
+  int rcvbuf = 0;
+  int sndbuf = 0;
+
+  // Unsent bytes the kernel holds before poll reports the socket writable
+  int notsent_lowat = 0;
+
+  // Microseconds to busy poll the device queue on blocking reads
+  int busy_poll = 0;
+
+  // Listening sockets only: accept once data has arrived, waiting at most this many seconds
+  int defer_accept = 0;
+
+  // Listening sockets: the queue length of pending fast open requests
+  // Connecting sockets: any value other than 0 sends the first data with the SYN
+  int fastopen = 0;
+};
+
+/*
+ * Apply the options for connected sockets
+ * @return -1 if an option could not be set
+ */
+int set_options(int fd, const socket_profile_t &profile);
+
+/*
+ * Apply the options for listening sockets, call it before listen()
+ * @return -1 if an option could not be set
+ */
+int set_listener_options(int fd, const socket_profile_t &profile);
+
+// The options of profile are best effort, only a failed connect fails
+io connect(const char *hostname, const char *port, const socket_profile_t &profile = {});
+
+/*
+ * Holds back partial segments while in scope with TCP_CORK,
+ * so a batch of print() calls leaves as full segments.
+ */
+class Cork {
+  int _fd;
+
+public:
+  explicit Cork(int fd);
+
+  template<class Stream>
+  explicit Cork(FD<Stream> &file) : Cork(file.getStream().fd()) {}
+
+  Cork(const Cork&) = delete;
+  Cork &operator=(const Cork&) = delete;
+
+  // Sends what was held back
+  ~Cork();
+};
 }
 
-#endif
\ No newline at end of file
+#endif
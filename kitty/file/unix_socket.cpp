@@ -0,0 +1,222 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <cstring>
+
+#include <kitty/file/unix_socket.h>
+#include <kitty/err/err.h>
+
+// Where the flag is missing, the descriptors are marked right after they arrive
+#ifndef MSG_CMSG_CLOEXEC
+#define MSG_CMSG_CLOEXEC 0
+#endif
+
+// macOS has SO_NOSIGPIPE instead, set on the socket by connect_unix
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace file {
+namespace stream {
+// The byte send_fds sends the descriptors with
+static constexpr unsigned char CARRIER = 0;
+
+unix_io::~unix_io() {
+  for(auto fd : _fds) {
+    close(fd);
+  }
+}
+
+unix_io &unix_io::operator=(unix_io &&other) noexcept {
+  io::operator=(std::move(other));
+  std::swap(_fds, other._fds);
+
+  return *this;
+}
+
+int unix_io::read(std::vector<unsigned char> &buf) {
+  std::uint8_t control[CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS)];
+
+  iovec iov { buf.data(), buf.size() };
+
+  msghdr msg { 0 };
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t bytes_read;
+  if((bytes_read = recvmsg(_fd, &msg, MSG_CMSG_CLOEXEC)) < 0) {
+    err::code = errno == EAGAIN || errno == EWOULDBLOCK ? err::WOULD_BLOCK : err::LIB_SYS;
+    return -1;
+  }
+  else if(!bytes_read) {
+    _eof = true;
+  }
+
+  auto first = _fds.size();
+  for(auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+
+    auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    auto end   = _fds.size();
+
+    _fds.resize(end + count);
+    std::memcpy(_fds.data() + end, CMSG_DATA(cmsg), sizeof(int) * count);
+  }
+
+  if(!MSG_CMSG_CLOEXEC) {
+    for(auto it = std::begin(_fds) + first; it != std::end(_fds); ++it) {
+      fcntl(*it, F_SETFD, FD_CLOEXEC);
+    }
+  }
+
+  // Some descriptors were closed by the kernel, the ones that did arrive are of no use without them
+  if(msg.msg_flags & MSG_CTRUNC) {
+    for(auto it = std::begin(_fds) + first; it != std::end(_fds); ++it) {
+      close(*it);
+    }
+
+    _fds.resize(first);
+
+    err::set("Descriptors were truncated");
+    return -1;
+  }
+
+  // The kernel ends a read with the data that came with the descriptors, send_fds sends them on a lone carrier byte
+  if(_fds.size() > first && bytes_read > 0 && buf[bytes_read - 1] == CARRIER) {
+    --bytes_read;
+  }
+
+  // Update number of bytes in buf
+  buf.resize((std::size_t)bytes_read);
+  return 0;
+}
+
+std::size_t unix_io::take_fds(std::vector<int> &fds) {
+  auto count = _fds.size();
+
+  fds.insert(std::end(fds), std::begin(_fds), std::end(_fds));
+  _fds.clear();
+
+  return count;
+}
+
+void unix_io::seal() {
+  for(auto fd : _fds) {
+    close(fd);
+  }
+
+  _fds.clear();
+
+  io::seal();
+}
+}
+
+unix_io connect_unix(const char *path, int type) {
+  constexpr std::chrono::seconds timeout { 0 };
+
+  sockaddr_un addr { 0 };
+  addr.sun_family = AF_UNIX;
+
+  if(std::strlen(path) >= sizeof(addr.sun_path)) {
+    err::code = err::INVALID_INPUT;
+    return {};
+  }
+
+  std::strcpy(addr.sun_path, path);
+
+#ifdef SOCK_CLOEXEC
+  unix_io sock { timeout, socket(AF_UNIX, type | SOCK_CLOEXEC, 0) };
+#else
+  unix_io sock { timeout, socket(AF_UNIX, type, 0) };
+
+  if(sock.is_open()) {
+    fcntl(sock.getStream().fd(), F_SETFD, FD_CLOEXEC);
+  }
+#endif
+
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  if(sock.is_open()) {
+    setsockopt(sock.getStream().fd(), SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+  }
+#endif
+
+  if(!sock.is_open() || connect(sock.getStream().fd(), (const sockaddr *) &addr, sizeof(addr))) {
+    err::code = err::LIB_SYS;
+    return {};
+  }
+
+  return sock;
+}
+
+int send_fds(unix_io &sock, const std::vector<int> &fds) {
+  if(fds.empty() || fds.size() > MAX_PASSED_FDS) {
+    err::code = err::INVALID_INPUT;
+    return -1;
+  }
+
+  // The descriptors must not overtake data appended before them
+  if(sock.out() || sock.wait_writable()) {
+    return -1;
+  }
+
+  std::uint8_t control[CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS)];
+
+  auto carrier = stream::CARRIER;
+  iovec iov { &carrier, 1 };
+
+  msghdr msg { 0 };
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type  = SCM_RIGHTS;
+  cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * fds.size());
+  std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+  if(sendmsg(sock.getStream().fd(), &msg, MSG_NOSIGNAL) < 0) {
+    err::code = errno == EAGAIN || errno == EWOULDBLOCK ? err::WOULD_BLOCK : err::LIB_SYS;
+    return -1;
+  }
+
+  return 0;
+}
+
+int recv_fds(unix_io &sock, std::vector<int> &fds) {
+  while(!sock.getStream().take_fds(fds)) {
+    auto &cache = sock.get_read_cache();
+
+    if(!cache.empty()) {
+      err::set("Data arrived ahead of the descriptors");
+      return -1;
+    }
+
+    if(sock.wait_readable()) {
+      return -1;
+    }
+
+    // Read straight into the cache, so data that comes with the descriptors isn't lost
+    cache.resize(1024);
+    if(sock.getStream().read(cache)) {
+      cache.clear();
+      return -1;
+    }
+
+    if(sock.eof()) {
+      err::code = err::FILE_CLOSED;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+}
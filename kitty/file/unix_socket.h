@@ -0,0 +1,68 @@
+#ifndef KITTY_UNIX_SOCKET_H
+#define KITTY_UNIX_SOCKET_H
+
+#include <vector>
+#include <sys/socket.h>
+
+#include <kitty/file/io_stream.h>
+
+namespace file {
+// The most descriptors a single message can carry (SCM_MAX_FD)
+constexpr std::size_t MAX_PASSED_FDS = 253;
+
+namespace stream {
+/*
+ * A Unix domain socket, reads pick up descriptors sent with SCM_RIGHTS.
+ * They're queued until taken, whatever is left is closed with the socket.
+ * The carrier byte of send_fds is left out of the data, other data sent along with descriptors is kept.
+ * A read fails when the kernel had to drop descriptors (MSG_CTRUNC).
+ */
+class unix_io : public io {
+  std::vector<int> _fds;
+
+public:
+  using io::io;
+
+  unix_io() = default;
+  unix_io(unix_io &&) noexcept = default;
+  unix_io &operator=(unix_io &&other) noexcept;
+
+  ~unix_io();
+
+  int read(std::vector<unsigned char> &buf);
+
+  // Move the queued descriptors to the end of fds, @return The number moved
+  std::size_t take_fds(std::vector<int> &fds);
+
+  void seal();
+};
+}
+
+typedef FD<stream::unix_io> unix_io;
+
+/*
+ * Connect to the Unix domain socket at path.
+ * type is SOCK_STREAM or SOCK_SEQPACKET, a seqpacket read returns at most one message.
+ */
+unix_io connect_unix(const char *path, int type = SOCK_STREAM);
+
+/*
+ * Send fds with SCM_RIGHTS, after the data pending in the write cache.
+ * They're carried by a single byte the receiving unix_io leaves out of the data.
+ * The descriptors stay open on this end.
+ *
+ * @return -1 on failure
+ */
+int send_fds(unix_io &sock, const std::vector<int> &fds);
+
+/*
+ * Wait for descriptors and append them to fds, they have FD_CLOEXEC set.
+ * Data read along the way stays in the read cache.
+ * Fails when only data arrives, read it first and call recv_fds again.
+ *
+ * @return -1 on failure
+ */
+int recv_fds(unix_io &sock, std::vector<int> &fds);
+}
+
+#endif
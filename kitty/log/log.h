@@ -23,12 +23,14 @@ constexpr int DATE_BUFFER_SIZE = 21 + 1; // Full string plus '\0'
 
 extern THREAD_LOCAL util::ThreadLocal<char[DATE_BUFFER_SIZE]> _date;
 
+// Write only, a file::FD of a Log has no read cache and no timeout
 template<class Stream>
 class Log {
   Stream _stream;
 
   std::string _prepend;
 public:
+  static constexpr bool timeout = false;
 
   Log() = default;
   Log(Log &&other) noexcept = default;
@@ -38,10 +40,6 @@ public:
   template<class... Args>
   Log(std::string&& prepend, Args&&... params) : _stream(std::forward<Args>(params)...), _prepend(std::move(prepend)) {}
 
-  int read(std::vector<unsigned char>& buf) {
-    return -1;
-  }
-
   int write(std::vector<unsigned char>& buf) {
     std::time_t t = std::time(nullptr);
     strftime(_date, DATE_BUFFER_SIZE, "[%Y:%m:%d:%H:%M:%S]", std::localtime(&t));
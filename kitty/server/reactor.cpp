@@ -0,0 +1,321 @@
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <limits>
+#include <iterator>
+#include <algorithm>
+
+#include <kitty/server/reactor.h>
+#include <kitty/err/err.h>
+
+namespace server {
+static constexpr int MAX_EVENTS = 256;
+
+static std::uint32_t _events(Reactor::interest_t interest) {
+  std::uint32_t events = EPOLLRDHUP;
+
+  if(interest & Reactor::READ) {
+    events |= EPOLLIN;
+  }
+
+  if(interest & Reactor::WRITE) {
+    events |= EPOLLOUT;
+  }
+
+  return events;
+}
+
+Reactor::handler_t::handler_t() {
+  for(std::size_t x = 0; x < DEADLINES; ++x) {
+    _timers[x].data = { this, (deadline_t)x };
+  }
+}
+
+void Reactor::handler_t::expire_at(time_point at, deadline_t deadline) {
+  _reactor->_wheel.arm(_timers[deadline], _reactor->_tick(at));
+}
+
+void Reactor::handler_t::expire_after(std::chrono::milliseconds timeout, deadline_t deadline) {
+  expire_at(std::chrono::steady_clock::now() + timeout, deadline);
+}
+
+void Reactor::handler_t::cancel_timeout(deadline_t deadline) {
+  _reactor->_wheel.cancel(_timers[deadline]);
+}
+
+void Reactor::handler_t::cancel_timeouts() {
+  for(auto &timer : _timers) {
+    _reactor->_wheel.cancel(timer);
+  }
+}
+
+Reactor::Reactor() : _epollfd(-1), _wakefd(-1), _epoch(std::chrono::steady_clock::now()), _continue(true) {}
+
+Reactor::~Reactor() {
+  // Handlers that were never registered are destroyed with _queue_add
+  while(!_handlers.empty()) {
+    _close(*_handlers.back());
+  }
+
+  _closed.clear();
+
+  if(_wakefd != -1) {
+    close(_wakefd);
+  }
+
+  if(_epollfd != -1) {
+    close(_epollfd);
+  }
+}
+
+int Reactor::init() {
+  _epollfd = epoll_create1(EPOLL_CLOEXEC);
+  if(_epollfd == -1) {
+    err::code = err::LIB_SYS;
+    return -1;
+  }
+
+  _wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(_wakefd == -1) {
+    err::code = err::LIB_SYS;
+    return -1;
+  }
+
+  // The wakeup is the only event without a handler
+  epoll_event event { EPOLLIN, { nullptr } };
+  if(epoll_ctl(_epollfd, EPOLL_CTL_ADD, _wakefd, &event)) {
+    err::code = err::LIB_SYS;
+    return -1;
+  }
+
+  return 0;
+}
+
+void Reactor::add(std::unique_ptr<handler_t> &&handler) {
+  {
+    std::lock_guard<std::mutex> lg(_queue_lock);
+    _queue_add.emplace_back(std::move(handler));
+  }
+
+  _wake();
+}
+
+void Reactor::add(std::vector<std::unique_ptr<handler_t>> &&handlers) {
+  if(handlers.empty()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lg(_queue_lock);
+    std::move(std::begin(handlers), std::end(handlers), std::back_inserter(_queue_add));
+  }
+
+  _wake();
+}
+
+void Reactor::post(std::function<void()> &&f) {
+  {
+    std::lock_guard<std::mutex> lg(_queue_lock);
+    _queue_post.emplace_back(std::move(f));
+  }
+
+  _wake();
+}
+
+void Reactor::watch(handler_t &handler, interest_t interest) {
+  _apply(handler, interest);
+}
+
+void Reactor::stop() {
+  _continue.store(false);
+
+  _wake();
+}
+
+int Reactor::run() {
+  epoll_event events[MAX_EVENTS];
+
+  while(_continue.load()) {
+    int count = epoll_wait(_epollfd, events, MAX_EVENTS, _expire());
+
+    if(count < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+
+      err::code = err::LIB_SYS;
+      return -1;
+    }
+
+    for(int x = 0; x < count; ++x) {
+      auto handler = (handler_t*)events[x].data.ptr;
+      auto revents = events[x].events;
+
+      if(!handler) {
+        _drain();
+        continue;
+      }
+
+      // Closed by an earlier callback of this batch
+      if(handler->_interest == CLOSE) {
+        continue;
+      }
+
+      if(revents & (EPOLLERR | EPOLLHUP)) {
+        _close(*handler);
+        continue;
+      }
+
+      // A peer that shut down its side is still readable, the next read reports eof
+      if(revents & (EPOLLIN | EPOLLRDHUP)) {
+        _apply(*handler, handler->on_readable());
+
+        if(handler->_interest == CLOSE) {
+          continue;
+        }
+      }
+
+      if(revents & EPOLLOUT && handler->_interest & WRITE) {
+        _apply(*handler, handler->on_writable());
+      }
+    }
+
+    _closed.clear();
+  }
+
+  _drain();
+
+  while(!_handlers.empty()) {
+    _close(*_handlers.back());
+  }
+
+  _closed.clear();
+  return 0;
+}
+
+void Reactor::_wake() {
+  std::uint64_t one = 1;
+
+  // Only fails when the counter is already raised
+  (void)!write(_wakefd, &one, sizeof(one));
+}
+
+void Reactor::_drain() {
+  std::uint64_t count;
+  (void)!read(_wakefd, &count, sizeof(count));
+
+  std::vector<std::unique_ptr<handler_t>> add;
+  std::vector<std::function<void()>> post;
+  {
+    std::lock_guard<std::mutex> lg(_queue_lock);
+
+    add.swap(_queue_add);
+    post.swap(_queue_post);
+  }
+
+  for(auto &handler : add) {
+    _register(std::move(handler));
+  }
+
+  for(auto &f : post) {
+    f();
+  }
+}
+
+void Reactor::_register(std::unique_ptr<handler_t> &&handler) {
+  auto &ref = *handler;
+
+  ref._reactor = this;
+  ref._index   = _handlers.size();
+  ref._interest = NONE;
+
+  epoll_event event { 0, { &ref } };
+  if(epoll_ctl(_epollfd, EPOLL_CTL_ADD, ref.fd(), &event)) {
+    // The handler closes its file when it's destroyed
+    handler->on_close();
+    return;
+  }
+
+  _handlers.emplace_back(std::move(handler));
+
+  _apply(ref, ref.on_open());
+}
+
+void Reactor::_apply(handler_t &handler, interest_t interest) {
+  if(interest & CLOSE) {
+    _close(handler);
+    return;
+  }
+
+  if(interest == handler._interest) {
+    return;
+  }
+
+  epoll_event event { _events(interest), { &handler } };
+
+  // Without interest, only hang ups and errors are reported
+  if(interest == NONE) {
+    event.events = 0;
+  }
+
+  if(epoll_ctl(_epollfd, EPOLL_CTL_MOD, handler.fd(), &event)) {
+    _close(handler);
+    return;
+  }
+
+  handler._interest = interest;
+}
+
+void Reactor::_close(handler_t &handler) {
+  if(handler._interest == CLOSE) {
+    return;
+  }
+
+  handler._interest = CLOSE;
+  handler.cancel_timeouts();
+
+  epoll_ctl(_epollfd, EPOLL_CTL_DEL, handler.fd(), nullptr);
+
+  handler.on_close();
+
+  // Swap with the last handler, it's destroyed once no callback can refer to it anymore
+  auto index = handler._index;
+  std::swap(_handlers[index], _handlers.back());
+  _handlers[index]->_index = index;
+
+  _closed.emplace_back(std::move(_handlers.back()));
+  _handlers.pop_back();
+}
+
+int Reactor::_expire() {
+  auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _epoch).count();
+
+  _wheel.advance(now, [this](wheel_t::entry_t &entry) {
+    auto &timer = entry.data;
+
+    // Closed by an earlier timeout of this tick
+    if(timer.handler->_interest == CLOSE) {
+      return;
+    }
+
+    _apply(*timer.handler, timer.handler->on_timeout(timer.deadline));
+  });
+
+  if(!_wheel.size()) {
+    return -1;
+  }
+
+  return (int)std::min<wheel_t::tick_t>(_wheel.next(), std::numeric_limits<int>::max());
+}
+
+Reactor::wheel_t::tick_t Reactor::_tick(time_point t) const {
+  if(t <= _epoch) {
+    return 0;
+  }
+
+  // Round up, the deadline has passed once the wheel reaches the tick
+  return std::chrono::ceil<std::chrono::milliseconds>(t - _epoch).count();
+}
+}
@@ -0,0 +1,173 @@
+#ifndef KITTY_SERVER_REACTOR_H
+#define KITTY_SERVER_REACTOR_H
+
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include <kitty/util/timing_wheel.h>
+
+namespace server {
+/*
+ * An epoll loop that drives non-blocking connections.
+ *
+ * Every connection is a handler_t, a small state machine:
+ * each callback returns what the connection waits for next.
+ * All callbacks of a reactor run on the thread that calls run(),
+ * other threads hand work to it through add() and post().
+ * Deadlines are kept in a timing wheel with millisecond ticks, expired in bulk once per iteration.
+ *
+ * Linux only.
+ */
+class Reactor {
+public:
+  typedef std::chrono::steady_clock::time_point time_point;
+
+  enum interest_t {
+    NONE       = 0, // Keep the connection, but don't call back until watch() is called
+    READ       = 1,
+    WRITE      = 2,
+    READ_WRITE = READ | WRITE,
+    CLOSE      = 4  // Remove and destroy the handler
+  };
+
+  // Every handler has a deadline of each kind, they're armed independently
+  enum deadline_t {
+    IDLE,    // No activity on the connection
+    HEADER,  // The start of a request
+    REQUEST, // A whole request
+    DEADLINES
+  };
+
+  class handler_t;
+
+  struct timer_ref_t {
+    handler_t *handler;
+    deadline_t deadline;
+  };
+
+  typedef util::TimingWheel<timer_ref_t> wheel_t;
+
+  class handler_t {
+    friend class Reactor;
+
+  public:
+    // So that derived handlers can name them without Reactor::
+    typedef Reactor::interest_t interest_t;
+    typedef Reactor::deadline_t deadline_t;
+
+    static constexpr interest_t NONE       = Reactor::NONE;
+    static constexpr interest_t READ       = Reactor::READ;
+    static constexpr interest_t WRITE      = Reactor::WRITE;
+    static constexpr interest_t READ_WRITE = Reactor::READ_WRITE;
+    static constexpr interest_t CLOSE      = Reactor::CLOSE;
+
+    static constexpr deadline_t IDLE    = Reactor::IDLE;
+    static constexpr deadline_t HEADER  = Reactor::HEADER;
+    static constexpr deadline_t REQUEST = Reactor::REQUEST;
+
+  private:
+    Reactor *_reactor = nullptr;
+
+    // Position in Reactor::_handlers
+    std::size_t _index = 0;
+    interest_t _interest = NONE;
+
+    std::array<wheel_t::entry_t, DEADLINES> _timers;
+
+  public:
+    handler_t();
+    virtual ~handler_t() = default;
+
+    virtual int fd() = 0;
+
+    // Called once the handler is added, for connections that write first
+    virtual interest_t on_open() { return READ; }
+
+    virtual interest_t on_readable() = 0;
+    virtual interest_t on_writable() { return READ; }
+
+    // Called when a deadline set with expire_at() or expire_after() passes
+    virtual interest_t on_timeout(deadline_t) { return CLOSE; }
+
+    // Called before the handler is destroyed, whether it asked to be closed or the peer hung up
+    virtual void on_close() {}
+
+    // Only valid once the handler is added
+    Reactor &reactor() { return *_reactor; }
+
+    // Replaces the previous deadline of that kind, only call these from the thread of the reactor
+    // Re-arming is O(1), it's fine to push the idle deadline back on every read
+    void expire_at(time_point at, deadline_t deadline = IDLE);
+    void expire_after(std::chrono::milliseconds timeout, deadline_t deadline = IDLE);
+    void cancel_timeout(deadline_t deadline = IDLE);
+    void cancel_timeouts();
+  };
+
+  Reactor();
+  ~Reactor();
+
+  Reactor(const Reactor&) = delete;
+  Reactor &operator=(const Reactor&) = delete;
+
+  // @return -1 if epoll or the wakeup could not be created
+  int init();
+
+  // Thread safe, the handler is registered on the next iteration of run()
+  void add(std::unique_ptr<handler_t> &&handler);
+  void add(std::vector<std::unique_ptr<handler_t>> &&handlers);
+
+  // Thread safe, f is called on the thread of the reactor
+  void post(std::function<void()> &&f);
+
+  // Change what a handler waits for, only call this from the thread of the reactor
+  void watch(handler_t &handler, interest_t interest);
+
+  // Runs until stop() is called, all remaining handlers are closed before it returns
+  // @return -1 on failure
+  int run();
+
+  // Thread safe
+  void stop();
+
+  // The number of handlers, only exact on the thread of the reactor
+  std::size_t size() const { return _handlers.size(); }
+
+private:
+  void _wake();
+
+  void _drain();
+
+  void _register(std::unique_ptr<handler_t> &&handler);
+  void _apply(handler_t &handler, interest_t interest);
+  void _close(handler_t &handler);
+
+  // @return The timeout for epoll_wait in milliseconds
+  int _expire();
+
+  // The tick of the wheel at which t has passed
+  wheel_t::tick_t _tick(time_point t) const;
+
+  int _epollfd;
+  int _wakefd;
+
+  std::vector<std::unique_ptr<handler_t>> _handlers;
+
+  // Closed during the current batch of events
+  std::vector<std::unique_ptr<handler_t>> _closed;
+
+  time_point _epoch;
+  wheel_t _wheel;
+
+  std::mutex _queue_lock;
+  std::vector<std::unique_ptr<handler_t>> _queue_add;
+  std::vector<std::function<void()>> _queue_post;
+
+  std::atomic<bool> _continue;
+};
+}
+#endif
@@ -2,12 +2,27 @@
 #define DOSSIER_SERVER_H
 
 #include <poll.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include <set>
 #include <vector>
+#include <string>
+#include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include <tuple>
+#include <thread>
+#include <memory>
+#include <type_traits>
 
 #include <kitty/util/thread_pool.h>
 #include <kitty/util/optional.h>
@@ -15,6 +30,11 @@
 #include <kitty/util/auto_run.h>
 
 #include <kitty/file/file.h>
+#include <kitty/file/tcp.h>
+
+#ifdef __linux__
+#include <kitty/server/reactor.h>
+#endif
 
 #include <kitty/log/log.h>
 #include <kitty/err/err.h>
@@ -26,6 +46,164 @@ struct DefaultType {
   typedef char Type[0];
 };
 
+namespace _server {
+// Clients that declare a listener member are told which listener accepted them
+template<class Client, class = void>
+struct listener : std::false_type {};
+
+template<class Client>
+struct listener<Client, std::void_t<decltype(std::declval<Client&>().listener)>> : std::true_type {};
+
+// The socket profile holds TCP options, Unix domain and Bluetooth sockets are left alone
+template<class Sockaddr>
+struct inet : std::disjunction<std::is_same<Sockaddr, sockaddr_in>, std::is_same<Sockaddr, sockaddr_in6>> {};
+
+// Flags for the accepted sockets
+enum accept_flags_t {
+  NONBLOCK = 1,
+  CLOEXEC  = 2
+};
+
+inline int set_flags(int fd, int flags) {
+  if((flags & NONBLOCK) && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK)) {
+    return -1;
+  }
+
+  if((flags & CLOEXEC) && fcntl(fd, F_SETFD, FD_CLOEXEC)) {
+    return -1;
+  }
+
+  return 0;
+}
+
+// Without accept4, the flags are set right after accept
+inline int accept(int listenfd, sockaddr *addr, socklen_t *size, int flags) {
+#ifdef __linux__
+  return accept4(listenfd, addr, size, ((flags & NONBLOCK) ? SOCK_NONBLOCK : 0) | ((flags & CLOEXEC) ? SOCK_CLOEXEC : 0));
+#else
+  int fd = ::accept(listenfd, addr, size);
+
+  if(fd != -1 && set_flags(fd, flags)) {
+    close(fd);
+
+    return -1;
+  }
+
+  return fd;
+#endif
+}
+
+/*
+ * Readable once raised, until it's cleared. It wakes the accept loops on stop().
+ * An eventfd on Linux, a pipe elsewhere.
+ */
+class wakeup_t {
+  // Read end and write end, the same eventfd on Linux
+  int _fd[2] { -1, -1 };
+
+public:
+  wakeup_t() {
+#ifdef __linux__
+    _fd[0] = _fd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    if(pipe(_fd)) {
+      _fd[0] = _fd[1] = -1;
+    }
+    else if(set_flags(_fd[0], NONBLOCK | CLOEXEC) || set_flags(_fd[1], NONBLOCK | CLOEXEC)) {
+      close(_fd[0]);
+      close(_fd[1]);
+
+      _fd[0] = _fd[1] = -1;
+    }
+#endif
+  }
+
+  wakeup_t(const wakeup_t&) = delete;
+
+  ~wakeup_t() {
+    if(_fd[0] != -1) {
+      close(_fd[0]);
+    }
+
+    if(_fd[1] != _fd[0]) {
+      close(_fd[1]);
+    }
+  }
+
+  // -1 when it couldn't be created
+  int fd() const {
+    return _fd[0];
+  }
+
+  void raise() {
+    std::uint64_t one = 1;
+
+    // Only fails when it's raised already
+    (void)!write(_fd[1], &one, _fd[0] == _fd[1] ? sizeof(one) : 1);
+  }
+
+  void clear() {
+    std::uint64_t count;
+
+    // An eventfd is cleared by a single read, a pipe may hold a byte for every raise
+    while(read(_fd[0], &count, sizeof(count)) > 0 && _fd[0] != _fd[1]);
+  }
+};
+
+template<class Sockaddr>
+inline void unlink_stale(const Sockaddr &) {}
+
+/*
+ * The socket file of a server that's gone would fail bind, it's stale when nothing accepts on it anymore.
+ * The probe doesn't wait: a full backlog means a live server, which sees the probe as a client that hangs up.
+ */
+inline void unlink_stale(const sockaddr_un &addr) {
+  struct stat st;
+
+  // Abstract addresses have no file
+  if(!addr.sun_path[0] || stat(addr.sun_path, &st) || !S_ISSOCK(st.st_mode)) {
+    return;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd == -1) {
+    return;
+  }
+
+  if(set_flags(fd, NONBLOCK | CLOEXEC)) {
+    close(fd);
+
+    return;
+  }
+
+  // EAGAIN and EINPROGRESS come from a server that's alive
+  if(connect(fd, (const sockaddr *) &addr, sizeof(addr)) && errno == ECONNREFUSED) {
+    unlink(addr.sun_path);
+  }
+
+  close(fd);
+}
+}
+
+#ifdef __linux__
+/*
+ * A connection served by a Reactor, it owns the client.
+ * Derive from it and implement the callbacks of Reactor::handler_t,
+ * client.socket is non-blocking: reads and writes fail with err::WOULD_BLOCK instead of waiting.
+ */
+template<class T>
+class Connection : public Reactor::handler_t {
+public:
+  typedef T Client;
+
+  Client client;
+
+  explicit Connection(Client &&client) : client(std::move(client)) {}
+
+  int fd() override { return client.socket->getStream().fd(); }
+};
+#endif
+
 template<class T>
 class Server {
 public:
@@ -33,90 +211,757 @@ public:
   typedef typename Client::_sockaddr _sockaddr;
   typedef typename DefaultType<Client>::Type Member;
 
+#ifdef __linux__
+  typedef server::Connection<Client> Connection;
+
+  // Creates the connection for an accepted client, nullptr rejects the client
+  typedef std::function<std::unique_ptr<Connection>(Client &&)> factory_t;
+#endif
+
+  // The index of a listening address in the list given to start
+  typedef std::size_t listener_t;
+
 private:
-  pollfd _listenfd;
+  std::vector<pollfd> _listenfds;
+
+  _server::wakeup_t _wakeup;
+
+  // The clients handed to the workers of a pool, until their task is done
+  // Every pool has its own, so the shards don't share a lock
+  struct inflight_t {
+    std::mutex lock;
+    std::condition_variable done;
+
+    // Signaled when a client is done, for accept loops paused by admission control
+    std::condition_variable space;
+
+    // The sockets of the clients, their tickets own them until they're out of the set
+    std::multiset<int> fds;
+  };
 
+  // Clients handed to the workers of all pools
+  std::atomic<std::size_t> _clients { 0 };
+
+  // The clients plus the room accept loops reserved for the batch they're accepting, max_clients caps it
+  std::atomic<std::size_t> _slots { 0 };
+
+  // Declared before the pool, whose tasks release it
+  inflight_t _inflight;
   util::ThreadPool _task;
   
   util::AutoRun<void> _autoRun;
 
   Member _member;
+
+  int _backlog;
+
+  file::socket_profile_t _profile;
+public:
+
+  typedef util::ThreadPool::elastic_t workers_t;
+
+  // Client handlers block on I/O, the pool grows when they start queueing up
+  static constexpr workers_t DEFAULT_WORKERS { 1, 64 };
+
+  // The kernel caps it at net.core.somaxconn
+  static constexpr int DEFAULT_BACKLOG = SOMAXCONN;
+
+  // Clients accepted per wakeup, so a flood of connections can't keep the loop from stopping
+  static constexpr std::size_t MAX_ACCEPT_BATCH = 64;
+
+  /*
+   * Limits on the clients served by the workers, 0 means no limit.
+   * Beyond them, new connections are either left in the backlog or accepted and turned away.
+   */
+  struct admission_t {
+    enum overflow_t {
+      PAUSE, // Stop accepting until there is room again, the kernel queues new connections
+      REJECT // Accept, send reject_payload and close
+    };
+
+    // Clients handed to the workers whose handler hasn't returned yet
+    std::size_t max_clients = 0;
+
+    // Clients waiting for a worker
+    std::size_t max_pending = 0;
+
+    overflow_t overflow = PAUSE;
+
+    // Sent to rejected clients, keep it small: it's written from the accept loop
+    std::string reject_payload;
+  };
+
+  struct admission_stats_t {
+    // Clients currently handed to the workers
+    std::size_t clients;
+
+    std::uint64_t accepted;
+    std::uint64_t rejected;
+
+    // The number of times accepting was paused
+    std::uint64_t paused;
+  };
+
+  struct shards_t {
+    // 0 for one shard per cpu
+    std::size_t count = 0;
+
+    // The cpus the shards are pinned to, in order, empty for all cpus the process may run on
+    std::vector<int> cpus;
+
+    // The worker pool of each shard
+    workers_t workers = DEFAULT_WORKERS;
+  };
+
+private:
+  // Listening sockets with their own accept loop and workers
+  struct shard_t {
+    std::vector<pollfd> listenfds;
+
+    // Of the accept thread
+    util::thread_policy_t policy;
+
+    inflight_t inflight;
+    util::ThreadPool task;
+
+    util::AutoRun<void> autoRun;
+
+    shard_t(workers_t workers, util::thread_policy_t policy, util::thread_policy_t worker_policy) : policy(std::move(policy)), task(workers, std::move(worker_policy)) {}
+    ~shard_t() {
+      _close(listenfds);
+    }
+  };
+
+  mutable std::mutex _shard_lock;
+  std::vector<std::unique_ptr<shard_t>> _shards;
+
+  admission_t _admission;
+
+  std::atomic<std::uint64_t> _accepted { 0 };
+  std::atomic<std::uint64_t> _rejected { 0 };
+  std::atomic<std::uint64_t> _paused { 0 };
 public:
 
-  Server() : _task(1) {
+  Server(workers_t workers = DEFAULT_WORKERS) : _task(workers), _backlog(DEFAULT_BACKLOG) {
     static_assert(sizeof(Member) == 0, "Default constructor cannot be used when DefaultType is overriden");
   }
 
-  Server(Member&& member) : _task(1), _member(std::move(member)) { }
+  Server(Member&& member, workers_t workers = DEFAULT_WORKERS) : _task(workers), _member(std::move(member)), _backlog(DEFAULT_BACKLOG) { }
+
+  ~Server() {
+    stop();
+  }
+
+  // The queue of connections waiting for accept, used by the next call to start
+  Server &set_backlog(int backlog) {
+    _backlog = backlog;
+    return *this;
+  }
+
+  // Socket options for the listening socket and every accepted client, used by the next call to start
+  // Only for TCP servers, other socket families ignore it
+  Server &set_socket_profile(file::socket_profile_t profile) {
+    _profile = std::move(profile);
+    return *this;
+  }
+
+  // Applies to start() and start_sharded(), set it before starting
+  Server &set_admission(admission_t admission) {
+    _admission = std::move(admission);
+    return *this;
+  }
 
-  ~Server() { stop(); }
+  admission_stats_t admission_stats() {
+    return {
+      _clients.load(std::memory_order_relaxed),
+      _accepted.load(std::memory_order_relaxed),
+      _rejected.load(std::memory_order_relaxed),
+      _paused.load(std::memory_order_relaxed)
+    };
+  }
   
   // Returns -1 on failure
   int start(const _sockaddr &server, std::function<void(Client &&)> f) {
-    pollfd pfd {
-      _socket(),
-      POLLIN,
-      0
-    };
+    return start(std::vector<_sockaddr> { server }, std::move(f));
+  }
 
-    if(pfd.fd == -1) {
-      err::code = err::LIB_SYS;
+  /*
+   * Accept on every address in servers from a single loop, the clients share one worker pool.
+   * When Client has a listener member, it's set to the index of the address the client connected to.
+   *
+   * Returns -1 on failure
+   */
+  int start(const std::vector<_sockaddr> &servers, std::function<void(Client &&)> f) {
+    if(_bind(servers, _listenfds)) {
+      return -1;
+    }
+
+    _rearm();
+
+    // Each client gets a worker for as long as f blocks on it
+    return _listen(_autoRun, _listenfds, _server::CLOEXEC, &_task, &_inflight, [this, &f](std::vector<Client> &&batch) {
+      _post(_task, _inflight, f, std::move(batch));
+    });
+  }
+
+#ifdef __linux__
+  /*
+   * Reactor mode, for many mostly idle connections.
+   * Accepted clients are made non-blocking and handed to factory,
+   * the connections are spread over the event loops of reactors threads.
+   * CPU heavy work belongs on workers(), not on the event loops.
+   * Only for clients on a stream::io, ssl clients handshake in _accept and need start().
+   * The connections aren't tracked by drain(), close them from the factory's side.
+   *
+   * Returns -1 on failure
+   */
+  int start_reactor(const _sockaddr &server, factory_t factory, std::size_t reactors = 1) {
+    return start_reactor(std::vector<_sockaddr> { server }, std::move(factory), reactors);
+  }
+
+  // Reactor mode on every address in servers, see start(const std::vector<_sockaddr>&, ...)
+  int start_reactor(const std::vector<_sockaddr> &servers, factory_t factory, std::size_t reactors = 1) {
+    typedef std::decay_t<decltype(std::declval<Client&>().socket->getStream())> stream_t;
+
+    // A stream that must finish a handshake on accept, like ssl, can't be driven by a reactor
+    static_assert(std::is_base_of<file::stream::io, stream_t>::value, "Reactor mode needs clients on a plain non-blocking stream::io");
+
+    std::vector<std::unique_ptr<Reactor>> loops;
+    for(std::size_t x = 0; x < std::max<std::size_t>(1, reactors); ++x) {
+      loops.emplace_back(std::make_unique<Reactor>());
+
+      if(loops.back()->init()) {
+        return -1;
+      }
+    }
+
+    if(_bind(servers, _listenfds)) {
       return -1;
     }
 
-    // Allow reuse of local addresses
-    if(setsockopt(pfd.fd, SOL_SOCKET, SO_REUSEADDR, &pfd.fd, sizeof(pfd.fd))) {
+    _rearm();
+
+    std::vector<std::thread> threads;
+    for(auto &loop : loops) {
+      threads.emplace_back([&loop]() {
+        if(loop->run()) {
+          print(error, "Reactor stopped: ", err::current());
+        }
+      });
+    }
+
+    std::size_t next = 0;
+    std::vector<std::vector<std::unique_ptr<Reactor::handler_t>>> connections(loops.size());
+
+    int result = _listen(_autoRun, _listenfds, _server::NONBLOCK | _server::CLOEXEC, nullptr, nullptr, [&](std::vector<Client> &&batch) {
+      for(auto &client : batch) {
+        // The reactor decides when the socket is ready
+        client.socket->set_timeout(std::chrono::seconds(0));
+
+        if(auto connection = factory(std::move(client))) {
+          connections[next++ % loops.size()].emplace_back(std::move(connection));
+        }
+      }
+
+      // A single wakeup per reactor for the whole batch
+      for(std::size_t x = 0; x < loops.size(); ++x) {
+        loops[x]->add(std::move(connections[x]));
+        connections[x].clear();
+      }
+    });
+
+    for(auto &loop : loops) {
+      loop->stop();
+    }
+
+    for(auto &thread : threads) {
+      thread.join();
+    }
+
+    return result;
+  }
+#endif
+
+  /*
+   * Sharded mode, for high connection rates.
+   * Every shard binds its own socket to server with SO_REUSEPORT and the kernel spreads new connections over them.
+   * A shard has its own accept thread, pinned to a cpu, and a worker pool on the NUMA node of that cpu.
+   * Nothing is shared between shards.
+   * f runs on the workers of the shard that accepted the client.
+   *
+   * Returns -1 on failure
+   */
+  int start_sharded(const _sockaddr &server, std::function<void(Client &&)> f, shards_t shards = {}) {
+    return start_sharded(std::vector<_sockaddr> { server }, std::move(f), std::move(shards));
+  }
+
+  // Sharded mode on every address in servers, each shard binds all of them
+  int start_sharded(const std::vector<_sockaddr> &servers, std::function<void(Client &&)> f, shards_t shards = {}) {
+    auto count = shards.count;
+    if(!count) {
+      count = shards.cpus.empty() ? std::max(1u, std::thread::hardware_concurrency()) : shards.cpus.size();
+    }
+
+    util::thread_policy_t pinned;
+    pinned.affinity = util::thread_policy_t::PINNED;
+    pinned.cpus     = shards.cpus;
+
+    {
+      std::lock_guard<std::mutex> lg(_shard_lock);
+
+      for(std::size_t x = 0; x < count; ++x) {
+        util::thread_policy_t policy;
+        policy.affinity = util::thread_policy_t::PINNED;
+        policy.cpus     = util::policy_cpus(pinned, x);
+        policy.name     = "accept";
+
+        // Blocking handlers would compete for a single cpu, the workers get the node of the accept thread
+        util::thread_policy_t worker_policy;
+        worker_policy.affinity  = util::thread_policy_t::NUMA_NODE;
+        worker_policy.cpus      = shards.cpus;
+        worker_policy.numa_node = policy.cpus.empty() ? 0 : util::numa_node_of(policy.cpus.front(), shards.cpus);
+        worker_policy.name      = "shard" + std::to_string(x);
+
+        _shards.emplace_back(std::make_unique<shard_t>(shards.workers, std::move(policy), std::move(worker_policy)));
+
+        if(_bind(servers, _shards.back()->listenfds, true)) {
+          _shards.clear();
+          return -1;
+        }
+      }
+    }
+
+    _rearm();
+
+    std::atomic<bool> failed { false };
+
+    std::vector<std::thread> threads;
+    for(std::size_t x = 0; x < count; ++x) {
+      // _shards doesn't change until the threads are joined
+      auto &shard = *_shards[x];
+
+      threads.emplace_back([this, &shard, &f, &failed, x]() {
+        util::apply_thread_policy(shard.policy, x);
+
+        if(_listen(shard.autoRun, shard.listenfds, _server::CLOEXEC, &shard.task, &shard.inflight, [this, &shard, &f](std::vector<Client> &&batch) {
+          _post(shard.task, shard.inflight, f, std::move(batch));
+        })) {
+          failed.store(true);
+        }
+      });
+    }
+
+    for(auto &thread : threads) {
+      thread.join();
+    }
+
+    // Waits for the workers of the shards
+    {
+      std::lock_guard<std::mutex> lg(_shard_lock);
+      _shards.clear();
+    }
+
+    return failed.load() ? -1 : 0;
+  }
+
+  // Thread safe, the accept loops stop right away
+  void stop() {
+    _autoRun.stop();
+
+    {
+      std::lock_guard<std::mutex> lg(_shard_lock);
+      for(auto &shard : _shards) {
+        shard->autoRun.stop();
+        shard->inflight.space.notify_all();
+      }
+    }
+
+    _inflight.space.notify_all();
+
+    if(_wakeup.fd() != -1) {
+      _wakeup.raise();
+    }
+  }
+
+  /*
+   * Stop accepting and wait for the client handlers on the workers to finish, queued clients included.
+   * Once timeout has passed, the sockets of the remaining clients are shut down,
+   * their handlers then fail instead of waiting on the peer.
+   * Handlers that still haven't returned after another timeout are left running.
+   * Connections of start_reactor() aren't drained.
+   * The sockets are shut down by descriptor, a handler that moves its client out mustn't close it before returning.
+   * Don't call it from a client handler.
+   *
+   * @return The number of clients that were shut down
+   */
+  std::size_t drain(std::chrono::milliseconds timeout) {
+    stop();
+
+    // The shards stay alive until drain returns
+    std::lock_guard<std::mutex> lg(_shard_lock);
+
+    std::vector<inflight_t*> pools { &_inflight };
+    for(auto &shard : _shards) {
+      pools.emplace_back(&shard->inflight);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    if(_wait_done(pools, deadline)) {
+      return 0;
+    }
+
+    std::size_t forced = 0;
+    for(auto inflight : pools) {
+      std::lock_guard<std::mutex> inflight_lg(inflight->lock);
+
+      forced += inflight->fds.size();
+      for(auto fd : inflight->fds) {
+        shutdown(fd, SHUT_RDWR);
+      }
+    }
+
+    _wait_done(pools, std::chrono::steady_clock::now() + timeout);
+
+    return forced;
+  }
+
+  void join() {
+    stop();
+
+    _autoRun.join();
+
+    std::lock_guard<std::mutex> lg(_shard_lock);
+    for(auto &shard : _shards) {
+      shard->autoRun.join();
+    }
+  }
+
+  inline bool isRunning() const {
+    std::lock_guard<std::mutex> lg(_shard_lock);
+    for(auto &shard : _shards) {
+      if(shard->autoRun.isRunning()) {
+        return true;
+      }
+    }
+
+    return _autoRun.isRunning();
+  }
+
+  // The worker pool, for client handlers and work offloaded by connections
+  // In sharded mode, every shard has a pool of its own
+  util::ThreadPool &workers() { return _task; }
+
+private:
+  // Returns the listening socket or -1 on failure
+  int _bind(const _sockaddr &server, bool reuse_port = false) {
+    _server::unlink_stale(server);
+
+    int fd = _socket();
+    if(fd == -1) {
       err::code = err::LIB_SYS;
       return -1;
     }
 
-    if(bind(pfd.fd, (const sockaddr *) &server, sizeof(server)) < 0) {
+    int on = 1;
+
+    // Allow reuse of local addresses, the socket is non-blocking so _listen can drain its queue
+    if(
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) ||
+      (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on))) ||
+      bind(fd, (const sockaddr *) &server, sizeof(server)) < 0 ||
+      (_server::inet<_sockaddr>::value && file::set_listener_options(fd, _profile)) ||
+      listen(fd, _backlog) ||
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1
+    ) {
       err::code = err::LIB_SYS;
+
+      int error = errno;
+      close(fd);
+      errno = error;
+
+      return -1;
+    }
+
+    return fd;
+  }
+
+  // Bind every address in servers, on failure none of them stay open
+  int _bind(const std::vector<_sockaddr> &servers, std::vector<pollfd> &listenfds, bool reuse_port = false) {
+    _close(listenfds);
+
+    if(servers.empty()) {
+      err::code = err::INVALID_INPUT;
       return -1;
     }
 
-    listen(pfd.fd, 1);
+    for(auto &server : servers) {
+      int fd = _bind(server, reuse_port);
+      if(fd == -1) {
+        int error = errno;
+        _close(listenfds);
+        errno = error;
 
-    _listenfd = pfd;
+        return -1;
+      }
+
+      listenfds.push_back({ fd, POLLIN, 0 });
+    }
+
+    return 0;
+  }
+
+  static void _close(std::vector<pollfd> &listenfds) {
+    for(auto &listenfd : listenfds) {
+      close(listenfd.fd);
+    }
 
-    return _listen(f);
+    listenfds.clear();
   }
 
-  void stop() { _autoRun.stop(); }
-  void join() { _autoRun.join(); }
+  // @return true when every pool is done before deadline
+  static bool _wait_done(const std::vector<inflight_t*> &pools, std::chrono::steady_clock::time_point deadline) {
+    bool done = true;
+    for(auto inflight : pools) {
+      std::unique_lock<std::mutex> ul(inflight->lock);
 
-  inline bool isRunning() const { return _autoRun.isRunning(); }
+      done = inflight->done.wait_until(ul, deadline, [inflight]() { return inflight->fds.empty(); }) && done;
+    }
 
-private:
+    return done;
+  }
+
+  /*
+   * Keeps a client in inflight for as long as its task exists, whether it ran or was rejected.
+   * It owns the client, so the socket is only closed once drain can't reach it anymore.
+   */
+  struct ticket_t {
+    Server *server;
+    inflight_t *inflight;
+
+    Client client;
+    int fd;
+
+    ticket_t(Server *server, inflight_t *inflight, Client &&client) :
+      server(server), inflight(inflight), client(std::move(client)), fd(this->client.socket->getStream().fd()) {}
+    ticket_t(const ticket_t&) = delete;
+
+    ~ticket_t() {
+      {
+        std::lock_guard<std::mutex> lg(inflight->lock);
+
+        auto &fds = inflight->fds;
+        fds.erase(fds.find(fd));
+
+        server->_clients.fetch_sub(1, std::memory_order_relaxed);
+        server->_slots.fetch_sub(1, std::memory_order_relaxed);
+
+        if(fds.empty()) {
+          inflight->done.notify_all();
+        }
+
+        inflight->space.notify_all();
+      }
+
+      // client is closed after the set is unlocked
+    }
+  };
+
+  // Hand a batch of clients to the workers of task, one task per client
+  void _post(util::ThreadPool &task, inflight_t &inflight, const std::function<void(Client &&)> &f, std::vector<Client> &&batch) {
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(batch.size());
+
+    {
+      std::lock_guard<std::mutex> lg(inflight.lock);
+
+      for(auto &client : batch) {
+        auto ticket = std::make_shared<ticket_t>(this, &inflight, std::move(client));
+        inflight.fds.insert(ticket->fd);
+
+        _clients.fetch_add(1, std::memory_order_relaxed);
+
+        tasks.emplace_back([f, ticket]() {
+          f(std::move(ticket->client));
+        });
+      }
+    }
+
+    if(task.postBatch(std::move(tasks))) {
+      print(error, "Dropped clients: ", err::current());
+    }
+  }
+
+  // Clear a wakeup left by a previous stop()
+  void _rearm() {
+    if(_wakeup.fd() != -1) {
+      _wakeup.clear();
+    }
+  }
+
+  // @return The number of clients the workers of task may take on now, at most MAX_ACCEPT_BATCH
+  std::size_t _room(util::ThreadPool &task) {
+    std::size_t room = MAX_ACCEPT_BATCH;
+
+    if(_admission.max_pending) {
+      room = std::min(room, _admission.max_pending - std::min(_admission.max_pending, task.pending()));
+    }
+
+    if(_admission.max_clients) {
+      auto slots = _slots.load(std::memory_order_relaxed);
+      room = std::min(room, _admission.max_clients - std::min(_admission.max_clients, slots));
+    }
+
+    return room;
+  }
+
+  /*
+   * Reserve up to room slots right before accepting, so the shards can't overshoot max_clients together.
+   * The accepted clients keep theirs, give the rest back with _unreserve once the batch is dispatched.
+   *
+   * @return The number of slots reserved
+   */
+  std::size_t _reserve(std::size_t room) {
+    if(!_admission.max_clients) {
+      _slots.fetch_add(room, std::memory_order_relaxed);
+      return room;
+    }
+
+    auto slots = _slots.load(std::memory_order_relaxed);
+
+    std::size_t reserved;
+    do {
+      reserved = std::min(room, _admission.max_clients - std::min(_admission.max_clients, slots));
+    } while(!_slots.compare_exchange_weak(slots, slots + reserved, std::memory_order_relaxed));
 
-  int _listen(std::function<void(Client &&)> _action) {
+    return reserved;
+  }
+
+  void _unreserve(std::size_t reserved) {
+    if(reserved) {
+      _slots.fetch_sub(reserved, std::memory_order_relaxed);
+    }
+  }
+
+  void _reject(Client &client) {
+    _rejected.fetch_add(1, std::memory_order_relaxed);
+
+    if(!_admission.reject_payload.empty()) {
+      print(*client.socket, _admission.reject_payload);
+    }
+  }
+
+  /*
+   * Accepts until the queues of the listening sockets are empty, at most MAX_ACCEPT_BATCH clients at a time.
+   * The listeners take turns going first, so a busy one can't starve the others.
+   * flags, of _server::accept_flags_t, are set on the accepted sockets.
+   * When task is given, the admission limits are checked against it, a paused loop waits on inflight.
+   */
+  int _listen(util::AutoRun<void> &autoRun, std::vector<pollfd> &listenfds, int flags, util::ThreadPool *task, inflight_t *inflight, std::function<void(std::vector<Client> &&)> dispatch) {
     int result = 0;
 
-    
-    _autoRun.run([&]() {
-      if((result = poll(&_listenfd, 1, 100)) > 0) {
-        if(_listenfd.revents == POLLIN) {
-          DEBUG_LOG("Accepting client");
-
-          auto client = _accept();
-          if(client) {
-            auto c = util::cmove(*client);
-            _task.push([_action, c]() mutable {
-              _action(c);
-            });
+    bool paused = false;
+
+    // The wakeup comes last
+    std::vector<pollfd> fds { listenfds };
+    fds.push_back({ _wakeup.fd(), POLLIN, 0 });
+
+    std::size_t first = 0;
+
+    std::vector<Client> batch;
+    autoRun.run([&]() {
+      auto room = task ? _room(*task) : MAX_ACCEPT_BATCH;
+
+      // Leave new connections in the backlog until a client of this pool is done
+      // Clients of other shards and pending tasks are checked again after 10ms
+      if(!room && _admission.overflow == admission_t::PAUSE) {
+        if(!paused) {
+          paused = true;
+          _paused.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::unique_lock<std::mutex> ul(inflight->lock);
+        inflight->space.wait_for(ul, std::chrono::milliseconds(10));
+
+        return;
+      }
+
+      paused = false;
+
+      // Without the wakeup, stop() is noticed on the next timeout
+      if((result = poll(fds.data(), fds.size(), _wakeup.fd() == -1 ? 100 : -1)) > 0) {
+        if(fds.back().revents) {
+          autoRun.stop();
+          return;
+        }
+
+        DEBUG_LOG("Accepting clients");
+
+        // An idle loop holds no slots, the room may have shrunk while it waited
+        if(task) {
+          room = _reserve(room);
+        }
+
+        std::size_t accepted = 0;
+        for(std::size_t y = 0; y < listenfds.size(); ++y) {
+          listener_t listener = (first + y) % listenfds.size();
+          if(fds[listener].revents != POLLIN) {
+            continue;
+          }
+
+          // Fails with EAGAIN once the queue is drained
+          for(; accepted < MAX_ACCEPT_BATCH; ++accepted) {
+            if(batch.size() == room && _admission.overflow == admission_t::PAUSE) {
+              break;
+            }
+
+            auto client = _accept(listenfds[listener].fd, flags);
+            if(!client) {
+              break;
+            }
+
+            if constexpr (_server::listener<Client>::value) {
+              client->listener = listener;
+            }
+
+            // Best effort, a client isn't turned away for an option
+            if constexpr (_server::inet<_sockaddr>::value) {
+              file::set_options(client->socket->getStream().fd(), _profile);
+            }
+
+            if(batch.size() == room) {
+              _reject(*client);
+              continue;
+            }
+
+            batch.emplace_back(std::move(*client));
           }
         }
+
+        first = (first + 1) % listenfds.size();
+
+        auto dispatched = batch.size();
+        _accepted.fetch_add(dispatched, std::memory_order_relaxed);
+
+        if(!batch.empty()) {
+          dispatch(std::move(batch));
+          batch.clear();
+        }
+
+        // The dispatched clients hold on to their slots until their ticket is gone
+        if(task) {
+          _unreserve(room - dispatched);
+        }
       }
       else if(result == -1) {
         err::code = err::LIB_SYS;
         print(error, "Cannot poll socket: ", err::current());
 
-        _autoRun.stop();
+        autoRun.stop();
       }
     });
 
     // Cleanup
-    close(_listenfd.fd);
+    _close(listenfds);
     
     if(result == -1) {
       return -1;
@@ -128,7 +973,7 @@ private:
   /*
    * User defined methods
    */
-  util::Optional<Client> _accept();
+  util::Optional<Client> _accept(int listenfd, int flags);
 
   // Generate socket
   int _socket();
@@ -22,6 +22,9 @@ struct TcpClient {
 
   std::unique_ptr<file::io> socket;
   std::string ip_addr;
+
+  // Which of the addresses given to start() accepted the client
+  std::size_t listener = 0;
 };
 
 typedef Server<TcpClient> tcp;
@@ -0,0 +1,30 @@
+#include <memory>
+
+#include <kitty/server/server.h>
+#include <kitty/server/unix_client.h>
+
+namespace server {
+template<>
+util::Optional<local::Client> local::_accept(int listenfd, int flags) {
+  int client_fd = _server::accept(listenfd, nullptr, nullptr, flags);
+
+  if (client_fd < 0) {
+    return {};
+  }
+
+  ucred credentials { 0, (uid_t)-1, (gid_t)-1 };
+  socklen_t size { sizeof(credentials) };
+
+  getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size);
+
+  return Client {
+    std::make_unique<file::unix_io>(std::chrono::seconds(3), client_fd),
+    credentials
+  };
+}
+
+template<>
+int local::_socket() {
+  return socket(AF_UNIX, _member, 0);
+}
+};
@@ -0,0 +1,36 @@
+#ifndef UNIX_CLIENT_H
+#define UNIX_CLIENT_H
+
+#include <memory>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <kitty/file/unix_socket.h>
+#include <kitty/server/server.h>
+
+namespace server {
+
+struct UnixClient {
+  typedef sockaddr_un _sockaddr;
+
+  std::unique_ptr<file::unix_io> socket;
+
+  // The process on the other end (SO_PEERCRED)
+  ucred credentials;
+
+  // Which of the addresses given to start() accepted the client
+  std::size_t listener = 0;
+};
+
+// The socket type: SOCK_STREAM or SOCK_SEQPACKET
+template<>
+struct DefaultType<UnixClient> {
+  typedef int Type;
+};
+
+// server::local srv(SOCK_STREAM);
+typedef Server<UnixClient> local;
+}
+
+#endif
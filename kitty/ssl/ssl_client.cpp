@@ -6,11 +6,11 @@
 
 namespace server {
 template<>
-util::Optional<ssl::Client> ssl::_accept() {
+util::Optional<ssl::Client> ssl::_accept(int listenfd, int flags) {
   sockaddr_in6 client_addr;
   socklen_t addr_size {sizeof (client_addr)};
 
-  int client_fd = accept(_listenfd.fd, (sockaddr *) & client_addr, &addr_size);
+  int client_fd = _server::accept(listenfd, (sockaddr *) &client_addr, &addr_size, flags);
 
   if (client_fd < 0) {
     return {};
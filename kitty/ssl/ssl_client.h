@@ -13,6 +13,9 @@ struct SslClient {
 
   std::unique_ptr<file::ssl> socket;
   std::string ip_addr;
+
+  // Which of the addresses given to start() accepted the client
+  std::size_t listener = 0;
 };
 
 template<>
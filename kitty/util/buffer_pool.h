@@ -0,0 +1,345 @@
+#ifndef KITTY_UTIL_BUFFER_POOL_H
+#define KITTY_UTIL_BUFFER_POOL_H
+
+#include <array>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * A process wide pool of byte buffers, the caches of file::FD are borrowed from it.
+ *
+ * Buffers are sorted in power of two size classes from MIN_SIZE up to MAX_SIZE.
+ * Every thread keeps a few buffers of each class for itself and exchanges them in batches
+ * with a shared depot, so acquire() and release() rarely take a lock.
+ * Larger buffers aren't pooled.
+ * The limit counts the buffers cached by every thread as well as the depot.
+ *
+ * auto buf = util::buffer_pool::acquire(4096); // empty, capacity() >= 4096
+ * ...
+ * util::buffer_pool::release(std::move(buf));  // buf is left without memory
+ */
+namespace util {
+namespace buffer_pool {
+typedef std::vector<std::uint8_t> buffer_t;
+
+inline constexpr std::size_t MIN_SIZE = 1024;
+inline constexpr std::size_t MAX_SIZE = 1024 * 1024;
+
+struct stats_t {
+  // Buffers handed out and not yet released
+  std::size_t borrowed;
+  std::size_t peak_borrowed;
+
+  // Bytes held by buffers waiting in the pool, the caches of the threads included
+  std::size_t idle_bytes;
+  std::size_t peak_idle_bytes;
+
+  // Buffers that had to be allocated because the pool had none of the right size
+  std::uint64_t allocated;
+
+  // Buffers freed because the pool was full
+  std::uint64_t discarded;
+};
+
+namespace _buffer_pool {
+constexpr std::size_t CLASSES = 11; // 1KiB ... 1MiB
+
+constexpr std::size_t class_size(std::size_t class_) {
+  return MIN_SIZE << class_;
+}
+
+// The smallest class that holds size bytes
+inline std::size_t class_for(std::size_t size) {
+  std::size_t class_ = 0;
+  while(class_size(class_) < size) {
+    ++class_;
+  }
+
+  return class_;
+}
+
+// The largest class whose buffers fit in capacity
+inline std::size_t class_of(std::size_t capacity) {
+  std::size_t class_ = 0;
+  while(class_ + 1 < CLASSES && class_size(class_ + 1) <= capacity) {
+    ++class_;
+  }
+
+  return class_;
+}
+
+// The number of buffers of a class a thread keeps, about 256KiB worth
+constexpr std::size_t thread_limit(std::size_t class_) {
+  return std::max<std::size_t>(2, std::min<std::size_t>(32, 256 * 1024 / class_size(class_)));
+}
+
+inline void raise(std::atomic<std::size_t> &peak, std::size_t value) {
+  auto current = peak.load(std::memory_order_relaxed);
+  while(current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+struct depot_t {
+  std::mutex mutex;
+  std::array<std::vector<buffer_t>, CLASSES> classes;
+
+  // Buffers are freed rather than pooled once idle_bytes would exceed it
+  std::atomic<std::size_t> limit { 64 * 1024 * 1024 };
+
+  // Bytes held by the depot itself
+  std::size_t bytes = 0;
+
+  std::atomic<std::size_t> borrowed      { 0 };
+  std::atomic<std::size_t> peak_borrowed { 0 };
+
+  std::atomic<std::size_t> idle_bytes      { 0 };
+  std::atomic<std::size_t> peak_idle_bytes { 0 };
+
+  std::atomic<std::uint64_t> allocated { 0 };
+  std::atomic<std::uint64_t> discarded { 0 };
+
+  void idle(std::size_t bytes) {
+    raise(peak_idle_bytes, idle_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+  }
+
+  void unidle(std::size_t bytes) {
+    idle_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+};
+
+// Never destroyed, files with static storage duration may release their buffers during exit
+inline depot_t &depot() {
+  static auto *depot = new depot_t;
+
+  return *depot;
+}
+
+// Set once the cache of the current thread is destroyed, from then on the thread uses the depot directly
+inline thread_local bool cache_destroyed = false;
+
+struct cache_t {
+  std::array<std::vector<buffer_t>, CLASSES> classes;
+
+  // Move the buffers after the first keep buffers of a class to the depot
+  void spill(std::size_t class_, std::size_t keep) {
+    auto &local = classes[class_];
+    if(local.size() <= keep) {
+      return;
+    }
+
+    auto &depot = _buffer_pool::depot();
+    std::lock_guard<std::mutex> lg(depot.mutex);
+
+    auto &shared = depot.classes[class_];
+    while(local.size() > keep) {
+      auto size = local.back().capacity();
+
+      if(depot.bytes + size > depot.limit.load(std::memory_order_relaxed)) {
+        depot.unidle(size);
+        depot.discarded.fetch_add(1, std::memory_order_relaxed);
+      }
+      else {
+        depot.bytes += size;
+        shared.emplace_back(std::move(local.back()));
+      }
+
+      local.pop_back();
+    }
+  }
+
+  // Move up to count buffers of a class from the depot
+  void refill(std::size_t class_, std::size_t count) {
+    auto &depot = _buffer_pool::depot();
+    std::lock_guard<std::mutex> lg(depot.mutex);
+
+    auto &shared = depot.classes[class_];
+    for(; count && !shared.empty(); --count) {
+      depot.bytes -= shared.back().capacity();
+
+      classes[class_].emplace_back(std::move(shared.back()));
+      shared.pop_back();
+    }
+  }
+
+  ~cache_t() {
+    for(std::size_t class_ = 0; class_ < CLASSES; ++class_) {
+      spill(class_, 0);
+    }
+
+    cache_destroyed = true;
+  }
+};
+
+inline cache_t *cache() {
+  if(cache_destroyed) {
+    return nullptr;
+  }
+
+  static thread_local cache_t cache;
+  return &cache;
+}
+}
+
+/*
+ * @return An empty buffer with a capacity of at least size bytes
+ */
+inline buffer_t acquire(std::size_t size) {
+  auto &depot = _buffer_pool::depot();
+  _buffer_pool::raise(depot.peak_borrowed, depot.borrowed.fetch_add(1, std::memory_order_relaxed) + 1);
+
+  buffer_t buffer;
+  if(size > MAX_SIZE) {
+    depot.allocated.fetch_add(1, std::memory_order_relaxed);
+    buffer.reserve(size);
+
+    return buffer;
+  }
+
+  auto class_ = _buffer_pool::class_for(size);
+  if(auto cache = _buffer_pool::cache()) {
+    auto &local = cache->classes[class_];
+    if(local.empty()) {
+      cache->refill(class_, (_buffer_pool::thread_limit(class_) + 1) / 2);
+    }
+
+    if(!local.empty()) {
+      buffer = std::move(local.back());
+      local.pop_back();
+
+      depot.unidle(buffer.capacity());
+      return buffer;
+    }
+  }
+  else {
+    std::lock_guard<std::mutex> lg(depot.mutex);
+
+    auto &shared = depot.classes[class_];
+    if(!shared.empty()) {
+      buffer = std::move(shared.back());
+      shared.pop_back();
+
+      depot.bytes -= buffer.capacity();
+      depot.unidle(buffer.capacity());
+      return buffer;
+    }
+  }
+
+  depot.allocated.fetch_add(1, std::memory_order_relaxed);
+  buffer.reserve(_buffer_pool::class_size(class_));
+
+  return buffer;
+}
+
+/*
+ * Hand a buffer obtained through acquire() back to the pool, buffer is left empty without memory.
+ * Buffers that grew beyond MAX_SIZE are freed, buffers without memory are ignored.
+ */
+inline void release(buffer_t &&buffer) {
+  // Nothing was borrowed
+  if(!buffer.capacity()) {
+    return;
+  }
+
+  auto &depot = _buffer_pool::depot();
+  depot.borrowed.fetch_sub(1, std::memory_order_relaxed);
+
+  auto pooled = std::move(buffer);
+  buffer = buffer_t();
+
+  auto capacity = pooled.capacity();
+  if(capacity < MIN_SIZE || capacity > MAX_SIZE) {
+    return;
+  }
+
+  // Checked against every idle buffer, a thread cache can't hold memory the limit doesn't know about
+  if(depot.idle_bytes.load(std::memory_order_relaxed) + capacity > depot.limit.load(std::memory_order_relaxed)) {
+    depot.discarded.fetch_add(1, std::memory_order_relaxed);
+
+    return;
+  }
+
+  pooled.clear();
+  depot.idle(capacity);
+
+  auto class_ = _buffer_pool::class_of(capacity);
+  if(auto cache = _buffer_pool::cache()) {
+    auto &local = cache->classes[class_];
+    local.emplace_back(std::move(pooled));
+
+    auto limit = _buffer_pool::thread_limit(class_);
+    if(local.size() > limit) {
+      cache->spill(class_, limit / 2);
+    }
+
+    return;
+  }
+
+  std::lock_guard<std::mutex> lg(depot.mutex);
+
+  depot.bytes += capacity;
+  depot.classes[class_].emplace_back(std::move(pooled));
+}
+
+inline stats_t stats() {
+  auto &depot = _buffer_pool::depot();
+
+  return {
+    depot.borrowed.load(std::memory_order_relaxed),
+    depot.peak_borrowed.load(std::memory_order_relaxed),
+    depot.idle_bytes.load(std::memory_order_relaxed),
+    depot.peak_idle_bytes.load(std::memory_order_relaxed),
+    depot.allocated.load(std::memory_order_relaxed),
+    depot.discarded.load(std::memory_order_relaxed)
+  };
+}
+
+/*
+ * The maximum number of idle bytes in the pool, thread caches included. Buffers released beyond it are freed.
+ * Lowering it frees buffers from the depot, the caches of other threads shrink as they release buffers.
+ */
+inline void set_limit(std::size_t bytes) {
+  auto &depot = _buffer_pool::depot();
+  std::lock_guard<std::mutex> lg(depot.mutex);
+
+  depot.limit.store(bytes, std::memory_order_relaxed);
+
+  // Largest buffers first
+  for(auto shared = depot.classes.rbegin(); shared != depot.classes.rend(); ++shared) {
+    while(!shared->empty() && depot.idle_bytes.load(std::memory_order_relaxed) > bytes) {
+      auto size = shared->back().capacity();
+
+      depot.bytes -= size;
+      depot.unidle(size);
+
+      shared->pop_back();
+    }
+  }
+}
+
+// Free the buffers held by the depot and the cache of the calling thread
+inline void trim() {
+  if(auto cache = _buffer_pool::cache()) {
+    for(std::size_t class_ = 0; class_ < _buffer_pool::CLASSES; ++class_) {
+      cache->spill(class_, 0);
+    }
+  }
+
+  auto &depot = _buffer_pool::depot();
+  std::lock_guard<std::mutex> lg(depot.mutex);
+
+  for(auto &shared : depot.classes) {
+    for(auto &buffer : shared) {
+      depot.unidle(buffer.capacity());
+    }
+
+    shared = std::vector<buffer_t>();
+  }
+
+  depot.bytes = 0;
+}
+}
+}
+#endif
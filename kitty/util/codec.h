@@ -0,0 +1,666 @@
+#ifndef KITTY_UTIL_CODEC_H
+#define KITTY_UTIL_CODEC_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+
+#include <kitty/err/err.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KITTY_CODEC_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Bulk hexadecimal and base64 (RFC 4648, standard alphabet) codecs.
+ *
+ * On x86, SSSE3 and AVX2 kernels are selected at runtime, independent of the flags the code is compiled with.
+ * Every other platform uses the scalar code.
+ *
+ * Each codec comes in two forms:
+ *   raw:       (const in *, size, out *), out must have room for the *_size() of the input
+ *   container: (const In &in, Out &out), appends to out, e.g. a std::string or the write cache of a file::FD
+ *
+ * Decoding fails on malformed input with err::code set to err::INVALID_INPUT
+ */
+namespace util {
+namespace _codec {
+inline constexpr char HEX[] = "0123456789ABCDEF";
+inline constexpr char BASE64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+inline constexpr std::uint8_t INVALID = 0xFF;
+
+constexpr std::array<std::uint8_t, 256> make_hex_table() {
+  std::array<std::uint8_t, 256> table {};
+  for(auto &el : table) {
+    el = INVALID;
+  }
+
+  for(int x = 0; x < 10; ++x) {
+    table['0' + x] = x;
+  }
+
+  for(int x = 0; x < 6; ++x) {
+    table['a' + x] = 10 + x;
+    table['A' + x] = 10 + x;
+  }
+
+  return table;
+}
+
+constexpr std::array<std::uint8_t, 256> make_base64_table() {
+  std::array<std::uint8_t, 256> table {};
+  for(auto &el : table) {
+    el = INVALID;
+  }
+
+  for(int x = 0; x < 64; ++x) {
+    table[(std::uint8_t)BASE64[x]] = x;
+  }
+
+  return table;
+}
+
+inline constexpr auto hex_table = make_hex_table();
+inline constexpr auto base64_table = make_base64_table();
+
+inline std::size_t hex_encode_scalar(const std::uint8_t *in, std::size_t size, char *out) {
+  for(std::size_t x = 0; x < size; ++x) {
+    *out++ = HEX[in[x] >> 4];
+    *out++ = HEX[in[x] & 0xF];
+  }
+
+  return size;
+}
+
+// @return The number of characters decoded, less than size on invalid input
+inline std::size_t hex_decode_scalar(const char *in, std::size_t size, std::uint8_t *out) {
+  std::size_t x = 0;
+  for(; x + 1 < size; x += 2) {
+    auto hi = hex_table[(std::uint8_t)in[x]];
+    auto lo = hex_table[(std::uint8_t)in[x + 1]];
+
+    if(hi == INVALID || lo == INVALID) {
+      break;
+    }
+
+    *out++ = (hi << 4) | lo;
+  }
+
+  return x;
+}
+
+// @return The number of bytes encoded, a multiple of 3
+inline std::size_t base64_encode_scalar(const std::uint8_t *in, std::size_t size, char *out) {
+  std::size_t x = 0;
+  for(; x + 3 <= size; x += 3) {
+    std::uint32_t triple = (in[x] << 16) | (in[x + 1] << 8) | in[x + 2];
+
+    *out++ = BASE64[(triple >> 18) & 0x3F];
+    *out++ = BASE64[(triple >> 12) & 0x3F];
+    *out++ = BASE64[(triple >> 6)  & 0x3F];
+    *out++ = BASE64[triple & 0x3F];
+  }
+
+  return x;
+}
+
+// @return The number of characters decoded, a multiple of 4, stops at the first invalid character or padding
+inline std::size_t base64_decode_scalar(const char *in, std::size_t size, std::uint8_t *out) {
+  std::size_t x = 0;
+  for(; x + 4 <= size; x += 4) {
+    auto a = base64_table[(std::uint8_t)in[x]];
+    auto b = base64_table[(std::uint8_t)in[x + 1]];
+    auto c = base64_table[(std::uint8_t)in[x + 2]];
+    auto d = base64_table[(std::uint8_t)in[x + 3]];
+
+    if(a == INVALID || b == INVALID || c == INVALID || d == INVALID) {
+      break;
+    }
+
+    std::uint32_t triple = (a << 18) | (b << 12) | (c << 6) | d;
+
+    *out++ = triple >> 16;
+    *out++ = triple >> 8;
+    *out++ = triple;
+  }
+
+  return x;
+}
+
+#ifdef KITTY_CODEC_X86
+inline bool has_avx2() {
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+
+  return avx2;
+}
+
+inline bool has_ssse3() {
+  static const bool ssse3 = __builtin_cpu_supports("ssse3");
+
+  return ssse3;
+}
+
+// Each kernel processes whole blocks and returns the amount of input consumed, the caller finishes the rest
+
+__attribute__((target("ssse3")))
+inline std::size_t hex_encode_ssse3(const std::uint8_t *in, std::size_t size, char *out) {
+  const auto lut  = _mm_loadu_si128((const __m128i*)HEX);
+  const auto mask = _mm_set1_epi8(0x0F);
+
+  std::size_t x = 0;
+  for(; x + 16 <= size; x += 16) {
+    auto bytes = _mm_loadu_si128((const __m128i*)(in + x));
+
+    auto hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+    auto lo = _mm_shuffle_epi8(lut, _mm_and_si128(bytes, mask));
+
+    _mm_storeu_si128((__m128i*)(out + 2 * x),      _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128((__m128i*)(out + 2 * x + 16), _mm_unpackhi_epi8(hi, lo));
+  }
+
+  return x;
+}
+
+__attribute__((target("avx2")))
+inline std::size_t hex_encode_avx2(const std::uint8_t *in, std::size_t size, char *out) {
+  const auto lut  = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)HEX));
+  const auto mask = _mm256_set1_epi8(0x0F);
+
+  std::size_t x = 0;
+  for(; x + 32 <= size; x += 32) {
+    auto bytes = _mm256_loadu_si256((const __m256i*)(in + x));
+
+    auto hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+    auto lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(bytes, mask));
+
+    // Unpacking works per 128 bit lane, put the lanes back in order
+    auto first  = _mm256_unpacklo_epi8(hi, lo);
+    auto second = _mm256_unpackhi_epi8(hi, lo);
+
+    _mm256_storeu_si256((__m256i*)(out + 2 * x),      _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256((__m256i*)(out + 2 * x + 32), _mm256_permute2x128_si256(first, second, 0x31));
+  }
+
+  return x + hex_encode_ssse3(in + x, size - x, out + 2 * x);
+}
+
+/*
+ * Converts 16 hex characters to their values, pairs of values are then merged into bytes
+ * @return false if any character isn't a hex digit
+ */
+__attribute__((target("ssse3")))
+inline bool hex_values_ssse3(__m128i chars, __m128i &merged) {
+  auto digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+  auto alpha = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+
+  auto is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  auto is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+
+  if(_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) != 0xFFFF) {
+    return false;
+  }
+
+  auto values = _mm_or_si128(
+    _mm_and_si128(is_digit, digit),
+    _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10)))
+  );
+
+  // hi * 16 + lo
+  merged = _mm_maddubs_epi16(values, _mm_set1_epi16(0x0110));
+  return true;
+}
+
+__attribute__((target("ssse3")))
+inline std::size_t hex_decode_ssse3(const char *in, std::size_t size, std::uint8_t *out) {
+  std::size_t x = 0;
+  for(; x + 32 <= size; x += 32) {
+    __m128i first, second;
+
+    if(
+      !hex_values_ssse3(_mm_loadu_si128((const __m128i*)(in + x)), first) ||
+      !hex_values_ssse3(_mm_loadu_si128((const __m128i*)(in + x + 16)), second)
+    ) {
+      break;
+    }
+
+    _mm_storeu_si128((__m128i*)(out + x / 2), _mm_packus_epi16(first, second));
+  }
+
+  return x;
+}
+
+__attribute__((target("avx2")))
+inline bool hex_values_avx2(__m256i chars, __m256i &merged) {
+  auto digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+  auto alpha = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+
+  auto is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+  auto is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, _mm256_set1_epi8(5)), alpha);
+
+  if((std::uint32_t)_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) != 0xFFFFFFFF) {
+    return false;
+  }
+
+  auto values = _mm256_or_si256(
+    _mm256_and_si256(is_digit, digit),
+    _mm256_and_si256(is_alpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10)))
+  );
+
+  merged = _mm256_maddubs_epi16(values, _mm256_set1_epi16(0x0110));
+  return true;
+}
+
+__attribute__((target("avx2")))
+inline std::size_t hex_decode_avx2(const char *in, std::size_t size, std::uint8_t *out) {
+  std::size_t x = 0;
+  for(; x + 64 <= size; x += 64) {
+    __m256i first, second;
+
+    if(
+      !hex_values_avx2(_mm256_loadu_si256((const __m256i*)(in + x)), first) ||
+      !hex_values_avx2(_mm256_loadu_si256((const __m256i*)(in + x + 32)), second)
+    ) {
+      break;
+    }
+
+    // Packing works per 128 bit lane, put the quarters back in order
+    auto packed = _mm256_packus_epi16(first, second);
+    _mm256_storeu_si256((__m256i*)(out + x / 2), _mm256_permute4x64_epi64(packed, 0xD8));
+  }
+
+  return x + hex_decode_ssse3(in + x, size - x, out + x / 2);
+}
+
+/*
+ * Base64 kernels after Wojciech Muła and Daniel Lemire, "Faster Base64 Encoding and Decoding using AVX2 Instructions"
+ * Each 128 bit lane turns 12 bytes into 16 characters, or back.
+ */
+__attribute__((target("ssse3")))
+inline __m128i base64_encode_lane(__m128i in) {
+  // Spread each 3 bytes over 4, so every 6 bit index can be shifted into its own byte
+  in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+  auto t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+  auto t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  auto t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+  auto t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+
+  auto indices = _mm_or_si128(t1, t3);
+
+  // Translate the indices to the alphabet by adding the offset of their range
+  auto range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  auto less  = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  range = _mm_or_si128(range, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+  const auto offsets = _mm_setr_epi8(
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+  );
+
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+__attribute__((target("ssse3")))
+inline std::size_t base64_encode_ssse3(const std::uint8_t *in, std::size_t size, char *out) {
+  std::size_t x = 0;
+
+  // Reads 16 bytes to encode 12
+  for(; x + 16 <= size; x += 12) {
+    auto chars = base64_encode_lane(_mm_loadu_si128((const __m128i*)(in + x)));
+
+    _mm_storeu_si128((__m128i*)(out + x / 3 * 4), chars);
+  }
+
+  return x;
+}
+
+__attribute__((target("avx2")))
+inline std::size_t base64_encode_avx2(const std::uint8_t *in, std::size_t size, char *out) {
+  std::size_t x = 0;
+
+  // Reads 28 bytes to encode 24
+  for(; x + 28 <= size; x += 24) {
+    auto lo = base64_encode_lane(_mm_loadu_si128((const __m128i*)(in + x)));
+    auto hi = base64_encode_lane(_mm_loadu_si128((const __m128i*)(in + x + 12)));
+
+    _mm256_storeu_si256((__m256i*)(out + x / 3 * 4), _mm256_set_m128i(hi, lo));
+  }
+
+  return x + base64_encode_ssse3(in + x, size - x, out + x / 3 * 4);
+}
+
+/*
+ * Converts 16 characters to their 6 bit values
+ * @return false if any character is outside the alphabet, padding included
+ */
+__attribute__((target("ssse3")))
+inline bool base64_values_ssse3(__m128i &chars) {
+  const auto lut_lo = _mm_setr_epi8(
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+  );
+  const auto lut_hi = _mm_setr_epi8(
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+  );
+  const auto lut_roll = _mm_setr_epi8(
+    0, 16, 19, 4, -65, -65, -71, -71,
+    0, 0, 0, 0, 0, 0, 0, 0
+  );
+  const auto mask_2F = _mm_set1_epi8(0x2F);
+
+  auto hi_nibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), mask_2F);
+  auto lo_nibbles = _mm_and_si128(chars, mask_2F);
+
+  auto lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+  auto hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+
+  if(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) {
+    return false;
+  }
+
+  auto eq_2F = _mm_cmpeq_epi8(chars, mask_2F);
+  auto roll  = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2F, hi_nibbles));
+
+  chars = _mm_add_epi8(chars, roll);
+  return true;
+}
+
+// Packs 16 6 bit values into the first 12 bytes
+__attribute__((target("ssse3")))
+inline __m128i base64_decode_lane(__m128i values) {
+  auto merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+
+  return _mm_shuffle_epi8(merged, _mm_setr_epi8(
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+  ));
+}
+
+__attribute__((target("ssse3")))
+inline std::size_t base64_decode_ssse3(const char *in, std::size_t size, std::uint8_t *out) {
+  std::size_t x = 0;
+  for(; x + 16 <= size; x += 16) {
+    auto chars = _mm_loadu_si128((const __m128i*)(in + x));
+    if(!base64_values_ssse3(chars)) {
+      break;
+    }
+
+    auto bytes = base64_decode_lane(chars);
+
+    // Exactly 12 bytes, out may end right after them
+    auto dst = out + x / 4 * 3;
+    _mm_storel_epi64((__m128i*)dst, bytes);
+
+    std::uint32_t last = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+    std::memcpy(dst + 8, &last, 4);
+  }
+
+  return x;
+}
+
+__attribute__((target("avx2")))
+inline std::size_t base64_decode_avx2(const char *in, std::size_t size, std::uint8_t *out) {
+  std::size_t x = 0;
+  for(; x + 32 <= size; x += 32) {
+    auto lo = _mm_loadu_si128((const __m128i*)(in + x));
+    auto hi = _mm_loadu_si128((const __m128i*)(in + x + 16));
+
+    if(!base64_values_ssse3(lo) || !base64_values_ssse3(hi)) {
+      break;
+    }
+
+    auto bytes = _mm256_set_m128i(base64_decode_lane(hi), base64_decode_lane(lo));
+
+    // Gather the 2 x 12 bytes, without writing past them
+    bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+
+    auto dst = out + x / 4 * 3;
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(bytes));
+    _mm_storel_epi64((__m128i*)(dst + 16), _mm256_extracti128_si256(bytes, 1));
+  }
+
+  return x + base64_decode_ssse3(in + x, size - x, out + x / 4 * 3);
+}
+#endif
+}
+
+constexpr std::size_t hex_encoded_size(std::size_t size) {
+  return size * 2;
+}
+
+constexpr std::size_t hex_decoded_size(std::size_t size) {
+  return size / 2;
+}
+
+// Including padding
+constexpr std::size_t base64_encoded_size(std::size_t size) {
+  return (size + 2) / 3 * 4;
+}
+
+// An upper bound, padding makes the decoded data up to 2 bytes smaller
+constexpr std::size_t base64_decoded_size(std::size_t size) {
+  return (size + 3) / 4 * 3;
+}
+
+/*
+ * Writes hex_encoded_size(size) upper case characters to out
+ * @return The number of characters written
+ */
+inline std::size_t hex_encode(const std::uint8_t *in, std::size_t size, char *out) {
+  std::size_t x = 0;
+
+#ifdef KITTY_CODEC_X86
+  if(_codec::has_avx2()) {
+    x = _codec::hex_encode_avx2(in, size, out);
+  }
+  else if(_codec::has_ssse3()) {
+    x = _codec::hex_encode_ssse3(in, size, out);
+  }
+#endif
+
+  _codec::hex_encode_scalar(in + x, size - x, out + 2 * x);
+  return hex_encoded_size(size);
+}
+
+/*
+ * Accepts upper and lower case digits, size must be even
+ * @return The number of bytes written, or -1 on malformed input
+ */
+inline std::ptrdiff_t hex_decode(const char *in, std::size_t size, std::uint8_t *out) {
+  if(size % 2) {
+    err::code = err::INVALID_INPUT;
+
+    return -1;
+  }
+
+  std::size_t x = 0;
+
+#ifdef KITTY_CODEC_X86
+  if(_codec::has_avx2()) {
+    x = _codec::hex_decode_avx2(in, size, out);
+  }
+  else if(_codec::has_ssse3()) {
+    x = _codec::hex_decode_ssse3(in, size, out);
+  }
+#endif
+
+  // A kernel stops at the block with an invalid character, the scalar code finds it
+  x += _codec::hex_decode_scalar(in + x, size - x, out + x / 2);
+  if(x != size) {
+    err::code = err::INVALID_INPUT;
+
+    return -1;
+  }
+
+  return (std::ptrdiff_t)hex_decoded_size(size);
+}
+
+/*
+ * Writes base64_encoded_size(size) characters to out, padded with '='
+ * @return The number of characters written
+ */
+inline std::size_t base64_encode(const std::uint8_t *in, std::size_t size, char *out) {
+  std::size_t x = 0;
+
+#ifdef KITTY_CODEC_X86
+  if(_codec::has_avx2()) {
+    x = _codec::base64_encode_avx2(in, size, out);
+  }
+  else if(_codec::has_ssse3()) {
+    x = _codec::base64_encode_ssse3(in, size, out);
+  }
+#endif
+
+  x += _codec::base64_encode_scalar(in + x, size - x, out + x / 3 * 4);
+
+  out += x / 3 * 4;
+  switch(size - x) {
+    case 1:
+      *out++ = _codec::BASE64[in[x] >> 2];
+      *out++ = _codec::BASE64[(in[x] & 0x03) << 4];
+      *out++ = '=';
+      *out++ = '=';
+      break;
+    case 2:
+      *out++ = _codec::BASE64[in[x] >> 2];
+      *out++ = _codec::BASE64[((in[x] & 0x03) << 4) | (in[x + 1] >> 4)];
+      *out++ = _codec::BASE64[(in[x + 1] & 0x0F) << 2];
+      *out++ = '=';
+      break;
+  }
+
+  return base64_encoded_size(size);
+}
+
+/*
+ * Padding is optional, out must have room for base64_decoded_size(size) bytes
+ * @return The number of bytes written, or -1 on malformed input
+ */
+inline std::ptrdiff_t base64_decode(const char *in, std::size_t size, std::uint8_t *out) {
+  // Strip the padding, the remainder decides the number of trailing bytes
+  if(size % 4 == 0 && size && in[size - 1] == '=') {
+    size -= in[size - 2] == '=' ? 2 : 1;
+  }
+
+  if(size % 4 == 1) {
+    err::code = err::INVALID_INPUT;
+
+    return -1;
+  }
+
+  std::size_t x = 0;
+
+#ifdef KITTY_CODEC_X86
+  if(_codec::has_avx2()) {
+    x = _codec::base64_decode_avx2(in, size, out);
+  }
+  else if(_codec::has_ssse3()) {
+    x = _codec::base64_decode_ssse3(in, size, out);
+  }
+#endif
+
+  x += _codec::base64_decode_scalar(in + x, size - x, out + x / 4 * 3);
+
+  std::size_t written = x / 4 * 3;
+  std::size_t rest = size - x;
+
+  if(rest >= 4) {
+    err::code = err::INVALID_INPUT;
+
+    return -1;
+  }
+
+  if(rest) {
+    std::uint32_t triple = 0;
+    for(std::size_t y = 0; y < rest; ++y) {
+      auto val = _codec::base64_table[(std::uint8_t)in[x + y]];
+
+      if(val == _codec::INVALID) {
+        err::code = err::INVALID_INPUT;
+
+        return -1;
+      }
+
+      triple |= (std::uint32_t)val << (18 - 6 * y);
+    }
+
+    out[written++] = triple >> 16;
+    if(rest == 3) {
+      out[written++] = triple >> 8;
+    }
+  }
+
+  return (std::ptrdiff_t)written;
+}
+
+namespace _codec {
+template<class In>
+const std::uint8_t *bytes(const In &in) {
+  static_assert(sizeof(*std::data(in)) == 1, "The codecs work on bytes");
+
+  return reinterpret_cast<const std::uint8_t*>(std::data(in));
+}
+
+template<class Out>
+auto *grow(Out &out, std::size_t size) {
+  static_assert(sizeof(*std::data(out)) == 1, "The codecs work on bytes");
+
+  auto offset = out.size();
+  out.resize(offset + size);
+
+  return std::data(out) + offset;
+}
+}
+
+// Append the hex encoding of in to out
+template<class In, class Out>
+void hex_encode(const In &in, Out &out) {
+  auto dst = _codec::grow(out, hex_encoded_size(std::size(in)));
+
+  hex_encode(_codec::bytes(in), std::size(in), (char*)dst);
+}
+
+// Append the decoded bytes to out, on failure out is left as it was
+template<class In, class Out>
+int hex_decode(const In &in, Out &out) {
+  auto offset = out.size();
+  auto dst = _codec::grow(out, hex_decoded_size(std::size(in)));
+
+  if(hex_decode((const char*)_codec::bytes(in), std::size(in), (std::uint8_t*)dst) < 0) {
+    out.resize(offset);
+
+    return -1;
+  }
+
+  return 0;
+}
+
+template<class In, class Out>
+void base64_encode(const In &in, Out &out) {
+  auto dst = _codec::grow(out, base64_encoded_size(std::size(in)));
+
+  base64_encode(_codec::bytes(in), std::size(in), (char*)dst);
+}
+
+template<class In, class Out>
+int base64_decode(const In &in, Out &out) {
+  auto offset = out.size();
+  auto dst = _codec::grow(out, base64_decoded_size(std::size(in)));
+
+  auto written = base64_decode((const char*)_codec::bytes(in), std::size(in), (std::uint8_t*)dst);
+  if(written < 0) {
+    out.resize(offset);
+
+    return -1;
+  }
+
+  out.resize(offset + written);
+  return 0;
+}
+}
+#endif
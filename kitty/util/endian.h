@@ -0,0 +1,261 @@
+#ifndef KITTY_UTIL_ENDIAN_H
+#define KITTY_UTIL_ENDIAN_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include <kitty/util/utility.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KITTY_ENDIAN_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Bulk byte order conversion of arrays, the single value forms live in utility.h
+ *
+ * std::vector<std::uint32_t> samples = ...;
+ * util::endian::big_n(samples.data(), samples.size());
+ *
+ * Packed structs are converted field by field once their layout is described:
+ *
+ * struct __attribute__((packed)) sample_t { std::uint16_t channel; std::uint32_t value; std::uint8_t flags; };
+ * template<> struct util::endian::layout<sample_t> : util::endian::fields<2, 4, 1> {};
+ *
+ * util::endian::little_n(in, count, out);
+ *
+ * On x86, SSSE3 and AVX2 shuffles are selected at runtime, every other platform uses __builtin_bswap.
+ * In and out must either be the same array or not overlap at all.
+ */
+namespace util {
+namespace endian {
+// The sizes in bytes of the fields of a packed struct, in order
+template<std::size_t... Fields>
+struct fields {
+  static constexpr std::size_t size = (Fields + ... + 0);
+
+  // The position in the source element of each byte of the swapped element
+  static constexpr std::array<std::uint8_t, size> perm() {
+    std::array<std::uint8_t, size> perm {};
+    std::size_t sizes[] = { Fields... };
+
+    std::size_t begin = 0;
+    for(auto field : sizes) {
+      for(std::size_t x = 0; x < field; ++x) {
+        perm[begin + x] = (std::uint8_t)(begin + field - 1 - x);
+      }
+
+      begin += field;
+    }
+
+    return perm;
+  }
+};
+
+// Every arithmetic and enum type is a single field
+template<class T, class = void>
+struct layout {};
+
+template<class T>
+struct layout<T, std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value>> : fields<sizeof(T)> {};
+
+namespace _endian {
+template<class T, class Layout = layout<T>>
+constexpr bool check() {
+  static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be byte-swapped");
+  static_assert(Layout::size == sizeof(T), "The fields of util::endian::layout<T> don't add up to sizeof(T)");
+
+  return true;
+}
+
+/*
+ * The shuffle mask for a 16 byte lane holding as many whole elements as fit,
+ * the bytes of a trailing partial element map onto themselves.
+ */
+template<class Layout>
+constexpr std::array<std::uint8_t, 16> lane_mask() {
+  std::array<std::uint8_t, 16> mask {};
+  constexpr auto perm = Layout::perm();
+
+  std::size_t whole = 16 / Layout::size * Layout::size;
+  for(std::size_t x = 0; x < 16; ++x) {
+    mask[x] = x < whole ? (std::uint8_t)(x / Layout::size * Layout::size + perm[x % Layout::size]) : (std::uint8_t)x;
+  }
+
+  return mask;
+}
+
+template<class T, class Layout = layout<T>>
+void swap_scalar(const T *in, std::size_t count, T *out) {
+  if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+    for(std::size_t x = 0; x < count; ++x) {
+      out[x] = swap(in[x]);
+    }
+  }
+  else {
+    constexpr auto perm = Layout::perm();
+
+    for(std::size_t x = 0; x < count; ++x) {
+      std::uint8_t src[sizeof(T)];
+      std::memcpy(src, in + x, sizeof(T));
+
+      auto *dst = reinterpret_cast<std::uint8_t*>(out + x);
+      for(std::size_t y = 0; y < sizeof(T); ++y) {
+        dst[y] = src[perm[y]];
+      }
+    }
+  }
+}
+
+#ifdef KITTY_ENDIAN_X86
+inline bool has_avx2() {
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+
+  return avx2;
+}
+
+inline bool has_ssse3() {
+  static const bool ssse3 = __builtin_cpu_supports("ssse3");
+
+  return ssse3;
+}
+
+/*
+ * Each kernel processes whole lanes of elements of the given size
+ * @return The number of bytes processed, always a multiple of size
+ */
+__attribute__((target("ssse3")))
+inline std::size_t swap_ssse3(const std::uint8_t *in, std::size_t bytes, std::uint8_t *out, std::size_t size, const std::uint8_t *mask) {
+  const auto shuffle = _mm_loadu_si128((const __m128i*)mask);
+
+  // A partial element at the end of the lane is left as is and processed again by the next lane
+  std::size_t stride = 16 / size * size;
+
+  std::size_t x = 0;
+  for(; x + 16 <= bytes; x += stride) {
+    auto lane = _mm_loadu_si128((const __m128i*)(in + x));
+
+    _mm_storeu_si128((__m128i*)(out + x), _mm_shuffle_epi8(lane, shuffle));
+  }
+
+  return x;
+}
+
+// Only for sizes that divide 16, so that both lanes of a register start at an element
+__attribute__((target("avx2")))
+inline std::size_t swap_avx2(const std::uint8_t *in, std::size_t bytes, std::uint8_t *out, const std::uint8_t *mask) {
+  const auto shuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)mask));
+
+  std::size_t x = 0;
+  for(; x + 64 <= bytes; x += 64) {
+    auto first  = _mm256_loadu_si256((const __m256i*)(in + x));
+    auto second = _mm256_loadu_si256((const __m256i*)(in + x + 32));
+
+    _mm256_storeu_si256((__m256i*)(out + x),      _mm256_shuffle_epi8(first, shuffle));
+    _mm256_storeu_si256((__m256i*)(out + x + 32), _mm256_shuffle_epi8(second, shuffle));
+  }
+
+  for(; x + 32 <= bytes; x += 32) {
+    auto lane = _mm256_loadu_si256((const __m256i*)(in + x));
+
+    _mm256_storeu_si256((__m256i*)(out + x), _mm256_shuffle_epi8(lane, shuffle));
+  }
+
+  return x;
+}
+#endif
+
+template<class T, class Layout = layout<T>>
+void swap_n(const T *in, std::size_t count, T *out) {
+  static_assert(check<T, Layout>());
+
+  if constexpr (Layout::size == 1) {
+    if(in != out && count) {
+      std::memcpy(out, in, count);
+    }
+
+    return;
+  }
+
+  std::size_t x = 0;
+
+#ifdef KITTY_ENDIAN_X86
+  if constexpr (sizeof(T) <= 16) {
+    static constexpr auto mask = lane_mask<Layout>();
+
+    auto *src = reinterpret_cast<const std::uint8_t*>(in);
+    auto *dst = reinterpret_cast<std::uint8_t*>(out);
+
+    std::size_t bytes = 0;
+    if(16 % sizeof(T) == 0 && has_avx2()) {
+      bytes = swap_avx2(src, count * sizeof(T), dst, mask.data());
+    }
+    else if(has_ssse3()) {
+      bytes = swap_ssse3(src, count * sizeof(T), dst, sizeof(T), mask.data());
+    }
+
+    x = bytes / sizeof(T);
+  }
+#endif
+
+  swap_scalar<T, Layout>(in + x, count - x, out + x);
+}
+
+template<class T>
+void copy_n(const T *in, std::size_t count, T *out) {
+  static_assert(check<T>());
+
+  if(in != out && count) {
+    std::memcpy(out, in, count * sizeof(T));
+  }
+}
+}
+
+// Reverses the bytes of every field of every element in place
+template<class T>
+void swap_n(T *data, std::size_t count) {
+  _endian::swap_n(data, count, data);
+}
+
+template<class T>
+void swap_n(const T *in, std::size_t count, T *out) {
+  _endian::swap_n(in, count, out);
+}
+
+// Converts between host and big-endian byte order
+template<class T>
+void big_n(const T *in, std::size_t count, T *out) {
+  if constexpr (endianness<T>::little) {
+    _endian::swap_n(in, count, out);
+  }
+  else {
+    _endian::copy_n(in, count, out);
+  }
+}
+
+template<class T>
+void big_n(T *data, std::size_t count) {
+  big_n(data, count, data);
+}
+
+// Converts between host and little-endian byte order
+template<class T>
+void little_n(const T *in, std::size_t count, T *out) {
+  if constexpr (endianness<T>::big) {
+    _endian::swap_n(in, count, out);
+  }
+  else {
+    _endian::copy_n(in, count, out);
+  }
+}
+
+template<class T>
+void little_n(T *data, std::size_t count) {
+  little_n(data, count, data);
+}
+} /* endian */
+} /* util */
+#endif
@@ -0,0 +1,153 @@
+#ifndef KITTY_UTIL_EVENT_COUNT_H
+#define KITTY_UTIL_EVENT_COUNT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <climits>
+#include <cerrno>
+
+#ifdef __linux__
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <mutex>
+#include <condition_variable>
+#endif
+
+namespace util {
+/*
+ * Lets threads sleep on a condition that is not protected by a lock.
+ *
+ * A waiter announces itself with prepare_wait(), re-checks the condition
+ * and only then calls wait(key). A notify that lands in between bumps the epoch,
+ * causing wait(key) to return immediately instead of losing the wakeup.
+ *
+ * Notifying without any waiters costs a fence and a load.
+ */
+class EventCount {
+public:
+  typedef std::uint32_t key_t;
+
+private:
+  std::atomic<std::uint32_t> _epoch;
+  std::atomic<std::uint32_t> _waiters;
+
+#ifndef __linux__
+  std::mutex _lock;
+  std::condition_variable _cv;
+#endif
+
+public:
+  EventCount() : _epoch(0), _waiters(0) {}
+
+  EventCount(const EventCount&) = delete;
+  EventCount &operator=(const EventCount&) = delete;
+
+  key_t prepare_wait() {
+    _waiters.fetch_add(1, std::memory_order_relaxed);
+
+    // Pairs with the fence in _notify()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return _epoch.load(std::memory_order_relaxed);
+  }
+
+  void cancel_wait() {
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void wait(key_t key) {
+    _wait(key, nullptr);
+
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /*
+   * Returns after a notify or when time_point has passed
+   */
+  template<class Clock, class Duration>
+  void wait_until(key_t key, const std::chrono::time_point<Clock, Duration> &time_point) {
+    _wait(key, &time_point);
+
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void notify_one() { _notify(1); }
+  void notify_all() { _notify(INT_MAX); }
+
+  // Number of threads between prepare_wait() and the end of wait()
+  std::uint32_t waiters() const {
+    return _waiters.load(std::memory_order_relaxed);
+  }
+
+private:
+  void _notify(int count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if(!_waiters.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+#ifdef __linux__
+    _epoch.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&_epoch), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+    {
+      std::lock_guard<std::mutex> lg(_lock);
+      _epoch.fetch_add(1, std::memory_order_release);
+    }
+
+    if(count == 1) {
+      _cv.notify_one();
+    }
+    else {
+      _cv.notify_all();
+    }
+#endif
+  }
+
+  template<class TimePoint>
+  void _wait(key_t key, const TimePoint *time_point) {
+#ifdef __linux__
+    while(_epoch.load(std::memory_order_acquire) == key) {
+      timespec ts;
+      timespec *timeout = nullptr;
+
+      if(time_point) {
+        auto remaining = *time_point - TimePoint::clock::now();
+        if(remaining.count() <= 0) {
+          return;
+        }
+
+        auto nano = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+        ts.tv_sec  = (std::time_t)(nano / 1000000000);
+        ts.tv_nsec = (long)(nano % 1000000000);
+
+        timeout = &ts;
+      }
+
+      if(syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&_epoch), FUTEX_WAIT_PRIVATE, key, timeout, nullptr, 0) && errno == ETIMEDOUT) {
+        return;
+      }
+    }
+#else
+    std::unique_lock<std::mutex> ul(_lock);
+
+    auto pred = [&]() { return _epoch.load(std::memory_order_acquire) != key; };
+    if(time_point) {
+      _cv.wait_until(ul, *time_point, pred);
+    }
+    else {
+      _cv.wait(ul, pred);
+    }
+#endif
+  }
+
+  void _wait(key_t key, std::nullptr_t) {
+    _wait<std::chrono::steady_clock::time_point>(key, nullptr);
+  }
+};
+}
+#endif
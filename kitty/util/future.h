@@ -0,0 +1,525 @@
+#ifndef KITTY_UTIL_FUTURE_H
+#define KITTY_UTIL_FUTURE_H
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <future>
+#include <optional>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+#include <kitty/err/err.h>
+
+/*
+ * A future that doesn't need a thread to wait on it.
+ *
+ * Future<T>::then() schedules a continuation on an executor once the value arrives.
+ * An executor is anything with `int post(Function)`, like ThreadPool, that returns non-zero when rejecting the task.
+ *
+ * Calling get() from within a worker of the pool that must produce the value, may deadlock the pool.
+ */
+namespace util {
+template<class T>
+class Future;
+
+template<class T>
+class Promise;
+
+namespace _future {
+struct unit_t {};
+
+template<class T>
+struct storage {
+  typedef T type;
+};
+
+template<>
+struct storage<void> {
+  typedef unit_t type;
+};
+
+template<class T>
+class state_t;
+
+// Callbacks get the state rather than capturing it, so they can't keep it alive forever
+template<class T>
+class callback_t {
+public:
+  virtual ~callback_t() = default;
+
+  virtual void run(const std::shared_ptr<state_t<T>> &state) = 0;
+};
+
+template<class T, class Function>
+class callback_impl_t : public callback_t<T> {
+  Function _func;
+
+public:
+  callback_impl_t(Function &&f) : _func(std::move(f)) {}
+
+  void run(const std::shared_ptr<state_t<T>> &state) override {
+    _func(state);
+  }
+};
+
+template<class T>
+class state_t : public std::enable_shared_from_this<state_t<T>> {
+public:
+  typedef typename storage<T>::type value_t;
+
+  std::mutex lock;
+  std::condition_variable cv;
+
+  std::optional<value_t> value;
+  std::exception_ptr error;
+  bool ready = false;
+
+  // Run once, by the thread that makes the state ready
+  std::vector<std::unique_ptr<callback_t<T>>> callbacks;
+
+  template<class... V>
+  void set_value(V&&... v) {
+    _set([&]() { value.emplace(std::forward<V>(v)...); });
+  }
+
+  void set_exception(std::exception_ptr e) {
+    _set([&]() { error = std::move(e); });
+  }
+
+  // Fail with broken_promise, unless the state is already ready
+  void abandon() {
+    {
+      std::lock_guard<std::mutex> lg(lock);
+
+      if(ready) {
+        return;
+      }
+    }
+
+    set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+  }
+
+  template<class Function>
+  void on_ready(Function &&f) {
+    std::unique_lock<std::mutex> ul(lock);
+
+    if(ready) {
+      ul.unlock();
+      f(this->shared_from_this());
+
+      return;
+    }
+
+    typedef std::decay_t<Function> func_t;
+    callbacks.emplace_back(std::make_unique<callback_impl_t<T, func_t>>(func_t(std::forward<Function>(f))));
+  }
+
+private:
+  template<class Function>
+  void _set(Function &&f) {
+    std::vector<std::unique_ptr<callback_t<T>>> cbs;
+    {
+      std::lock_guard<std::mutex> lg(lock);
+
+      if(ready) {
+        throw std::future_error(std::future_errc::promise_already_satisfied);
+      }
+
+      f();
+      ready = true;
+      cbs.swap(callbacks);
+    }
+
+    cv.notify_all();
+
+    auto self = this->shared_from_this();
+    for(auto &cb : cbs) {
+      cb->run(self);
+    }
+  }
+};
+
+inline std::exception_ptr rejected() {
+  return std::make_exception_ptr(std::runtime_error(err::current()));
+}
+
+// Fulfill promise with the result of f, called with the value in state
+template<class R, class T, class Function>
+void fulfill(Promise<R> &promise, Function &f, state_t<T> &state) {
+  if(state.error) {
+    promise.set_exception(state.error);
+
+    return;
+  }
+
+  try {
+    if constexpr (std::is_void<T>::value) {
+      if constexpr (std::is_void<R>::value) {
+        f();
+        promise.set_value();
+      }
+      else {
+        promise.set_value(f());
+      }
+    }
+    else {
+      if constexpr (std::is_void<R>::value) {
+        f(std::move(*state.value));
+        promise.set_value();
+      }
+      else {
+        promise.set_value(f(std::move(*state.value)));
+      }
+    }
+  } catch(...) {
+    promise.set_exception(std::current_exception());
+  }
+}
+
+/*
+ * The promise of a task posted to an executor, shared by the copies of the task.
+ * Executors may discard a task without running it, the last copy then breaks the promise
+ * the way a discarded std::packaged_task would.
+ */
+template<class R>
+struct pledge_t {
+  Promise<R> promise;
+
+  pledge_t() = default;
+  pledge_t(const pledge_t&) = delete;
+
+  ~pledge_t() {
+    promise._abandon();
+  }
+};
+
+template<class T, class Function>
+struct result_of {
+  typedef decltype(std::declval<Function&>()(std::declval<T>())) type;
+};
+
+template<class Function>
+struct result_of<void, Function> {
+  typedef decltype(std::declval<Function&>()()) type;
+};
+}
+
+template<class T>
+class Promise {
+  std::shared_ptr<_future::state_t<T>> _state;
+
+public:
+  Promise() : _state(std::make_shared<_future::state_t<T>>()) {}
+
+  Future<T> get_future() {
+    return Future<T>(_state);
+  }
+
+  template<class... V>
+  void set_value(V&&... v) {
+    _state->set_value(std::forward<V>(v)...);
+  }
+
+  void set_exception(std::exception_ptr e) {
+    _state->set_exception(std::move(e));
+  }
+
+  // Called from destructors, whatever the continuations throw can't be passed on
+  void _abandon() noexcept {
+    try {
+      _state->abandon();
+    } catch(...) {}
+  }
+};
+
+template<class T>
+class Future {
+  template<class> friend class Promise;
+  template<class> friend class Future;
+
+  std::shared_ptr<_future::state_t<T>> _state;
+
+  explicit Future(std::shared_ptr<_future::state_t<T>> state) : _state(std::move(state)) {}
+public:
+  typedef T value_type;
+
+  Future() = default;
+
+  bool valid() const {
+    return (bool)_state;
+  }
+
+  bool ready() const {
+    std::lock_guard<std::mutex> lg(_state->lock);
+
+    return _state->ready;
+  }
+
+  void wait() const {
+    std::unique_lock<std::mutex> ul(_state->lock);
+
+    _state->cv.wait(ul, [this]() { return _state->ready; });
+  }
+
+  /*
+   * Blocks until the value has arrived, rethrows the exception of the producer
+   * Invalidates the future
+   */
+  T get() {
+    wait();
+
+    auto state = std::move(_state);
+    if(state->error) {
+      std::rethrow_exception(state->error);
+    }
+
+    if constexpr (!std::is_void<T>::value) {
+      return std::move(*state->value);
+    }
+  }
+
+  /*
+   * Once the value arrives, f is called with it on executor.
+   * If this future holds an exception, f is skipped and the exception is passed on.
+   * Invalidates the future
+   *
+   * @return The future of the result of f
+   */
+  template<class Executor, class Function>
+  auto then(Executor &executor, Function &&f) {
+    typedef typename _future::result_of<T, std::decay_t<Function>>::type R;
+
+    auto pledge = std::make_shared<_future::pledge_t<R>>();
+    auto future = pledge->promise.get_future();
+
+    auto state = std::move(_state);
+    state->on_ready([&executor, pledge = std::move(pledge), f = std::decay_t<Function>(std::forward<Function>(f))](const auto &state) mutable {
+      auto task = [state, pledge, f = std::move(f)]() mutable {
+        _future::fulfill(pledge->promise, f, *state);
+      };
+
+      if(executor.post(std::move(task))) {
+        pledge->promise.set_exception(_future::rejected());
+      }
+    });
+
+    return future;
+  }
+
+  /*
+   * Run f with the state on the thread that makes the value ready, for continuations too cheap to schedule
+   * Invalidates the future
+   */
+  template<class Function>
+  void _on_ready(Function &&f) {
+    auto state = std::move(_state);
+
+    state->on_ready(std::forward<Function>(f));
+  }
+};
+
+template<class T>
+Future<std::decay_t<T>> make_ready_future(T &&val) {
+  Promise<std::decay_t<T>> promise;
+
+  promise.set_value(std::forward<T>(val));
+  return promise.get_future();
+}
+
+inline Future<void> make_ready_future() {
+  Promise<void> promise;
+
+  promise.set_value();
+  return promise.get_future();
+}
+
+/*
+ * Run f with args on executor
+ *
+ * @return The future of the result of f
+ */
+template<class Executor, class Function, class... Args>
+auto async(Executor &executor, Function &&f, Args&&... args) {
+  auto bound = std::bind(std::forward<Function>(f), std::forward<Args>(args)...);
+  typedef decltype(bound()) R;
+
+  auto pledge = std::make_shared<_future::pledge_t<R>>();
+  auto future = pledge->promise.get_future();
+
+  auto task = [pledge, bound = std::move(bound)]() mutable {
+    auto &promise = pledge->promise;
+
+    try {
+      if constexpr (std::is_void<R>::value) {
+        bound();
+        promise.set_value();
+      }
+      else {
+        promise.set_value(bound());
+      }
+    } catch(...) {
+      promise.set_exception(std::current_exception());
+    }
+  };
+
+  if(executor.post(std::move(task))) {
+    pledge->promise.set_exception(_future::rejected());
+  }
+
+  return future;
+}
+
+namespace _future {
+template<class T>
+bool all_valid(const std::vector<Future<T>> &futures) {
+  for(auto &future : futures) {
+    if(!future.valid()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+inline std::exception_ptr no_state() {
+  return std::make_exception_ptr(std::future_error(std::future_errc::no_state));
+}
+}
+
+/*
+ * Ready once all futures are ready.
+ * If any future holds an exception, the first one in order is passed on.
+ * Fails with no_state if one of futures isn't valid.
+ */
+template<class T>
+auto when_all(std::vector<Future<T>> futures) {
+  typedef std::conditional_t<std::is_void<T>::value, void, std::vector<T>> R;
+  typedef typename _future::storage<T>::type value_t;
+
+  struct all_t {
+    std::vector<std::optional<value_t>> values;
+    std::vector<std::exception_ptr> errors;
+
+    std::atomic<std::size_t> remaining;
+    Promise<R> promise;
+  };
+
+  auto all = std::make_shared<all_t>();
+  all->values.resize(futures.size());
+  all->errors.resize(futures.size());
+  all->remaining = futures.size() + 1;
+
+  auto future = all->promise.get_future();
+
+  if(!_future::all_valid(futures)) {
+    all->promise.set_exception(_future::no_state());
+
+    return future;
+  }
+
+  auto done = [all]() {
+    if(--all->remaining) {
+      return;
+    }
+
+    for(auto &error : all->errors) {
+      if(error) {
+        all->promise.set_exception(error);
+
+        return;
+      }
+    }
+
+    if constexpr (std::is_void<T>::value) {
+      all->promise.set_value();
+    }
+    else {
+      std::vector<T> values;
+      values.reserve(all->values.size());
+
+      for(auto &value : all->values) {
+        values.emplace_back(std::move(*value));
+      }
+
+      all->promise.set_value(std::move(values));
+    }
+  };
+
+  for(std::size_t x = 0; x < futures.size(); ++x) {
+    futures[x]._on_ready([all, x, done](const auto &state) {
+      if(state->error) {
+        all->errors[x] = state->error;
+      }
+      else {
+        all->values[x] = std::move(*state->value);
+      }
+
+      done();
+    });
+  }
+
+  // Accounts for the + 1, also completes an empty when_all
+  done();
+
+  return future;
+}
+
+/*
+ * Ready once any future is ready
+ * Fails with no_state if one of futures isn't valid.
+ *
+ * @return The future of the index of the first ready future, and its value
+ */
+template<class T>
+auto when_any(std::vector<Future<T>> futures) {
+  typedef std::conditional_t<std::is_void<T>::value, std::size_t, std::pair<std::size_t, T>> R;
+
+  struct any_t {
+    std::atomic<bool> done;
+    Promise<R> promise;
+  };
+
+  auto any = std::make_shared<any_t>();
+  any->done = false;
+
+  auto future = any->promise.get_future();
+
+  if(futures.empty()) {
+    any->promise.set_exception(std::make_exception_ptr(std::invalid_argument("when_any of nothing")));
+
+    return future;
+  }
+
+  if(!_future::all_valid(futures)) {
+    any->promise.set_exception(_future::no_state());
+
+    return future;
+  }
+
+  for(std::size_t x = 0; x < futures.size(); ++x) {
+    futures[x]._on_ready([any, x](const auto &state) {
+      if(any->done.exchange(true)) {
+        return;
+      }
+
+      if(state->error) {
+        any->promise.set_exception(state->error);
+      }
+      else if constexpr (std::is_void<T>::value) {
+        any->promise.set_value(x);
+      }
+      else {
+        any->promise.set_value(R { x, std::move(*state->value) });
+      }
+    });
+  }
+
+  return future;
+}
+}
+#endif
@@ -2,102 +2,192 @@
 #define KITTY_UTIL_ITERATOR_H
 
 #include <iterator>
+#include <cstddef>
+#include <type_traits>
 
 namespace util {
+namespace _itwrap {
+template<class T, class = void>
+struct has_dec : std::false_type {};
+
+template<class T>
+struct has_dec<T, std::void_t<decltype(std::declval<T&>().dec())>> : std::true_type {};
+
+template<class T, class = void>
+struct has_gt : std::false_type {};
+
+template<class T>
+struct has_gt<T, std::void_t<decltype(std::declval<const T&>().gt(std::declval<const T&>()))>> : std::true_type {};
+
+// void advance(std::ptrdiff_t step), step may be negative
+template<class T, class = void>
+struct has_advance : std::false_type {};
+
+template<class T>
+struct has_advance<T, std::void_t<decltype(std::declval<T&>().advance(std::ptrdiff_t()))>> : std::true_type {};
+
+// std::ptrdiff_t distance_to(const T &other) const, the number of steps from this to other
+template<class T, class = void>
+struct has_distance_to : std::false_type {};
+
+template<class T>
+struct has_distance_to<T, std::void_t<decltype(std::declval<const T&>().distance_to(std::declval<const T&>()))>> : std::true_type {};
+
+template<class T>
+struct is_random_access : std::integral_constant<bool, has_advance<T>::value && has_distance_to<T>::value> {};
+
+/*
+ * The category of the derived iterator T.
+ * T is incomplete while ItWrap<V, T> is instantiated, so this only derives from the real tag
+ * once an algorithm creates a category object, by which time T is complete.
+ */
+template<class T>
+struct category : std::conditional_t<
+  is_random_access<T>::value,
+  std::random_access_iterator_tag,
+  std::conditional_t<has_dec<T>::value, std::bidirectional_iterator_tag, std::forward_iterator_tag>
+> {};
+}
+
+/*
+ * Implements the iterator operators on top of a few members of the derived iterator T:
+ *   void inc();
+ *   bool eq(const T &other) const;
+ *   V *get();
+ *
+ * Optional:
+ *   void dec();                                      // Bidirectional
+ *   void advance(std::ptrdiff_t step);               // Random access, together with distance_to
+ *   std::ptrdiff_t distance_to(const T &other) const;
+ *   bool gt(const T &other) const;                   // Otherwise derived from distance_to
+ *
+ * Without advance() and distance_to(), jumps are emulated one step at a time
+ * and the iterator doesn't claim to be random access.
+ */
 template<class V, class T>
-class ItWrap : public std::iterator<std::random_access_iterator_tag, V> {
+class ItWrap {
 public:
   typedef T iterator;
-  typedef typename std::iterator<std::random_access_iterator_tag, V>::value_type class_t;
-  
+  typedef V class_t;
+
   typedef class_t& reference;
   typedef class_t* pointer;
-  
+
   typedef std::ptrdiff_t diff_t;
-  
-  iterator operator += (diff_t step) {
-    while(step-- > 0) {
-      ++_this();
+
+  typedef V value_type;
+  typedef diff_t difference_type;
+  typedef _itwrap::category<T> iterator_category;
+
+  iterator &operator += (diff_t step) {
+    if constexpr (_itwrap::has_advance<T>::value) {
+      _this().advance(step);
     }
-    
-    return _this();
-  }
-  
-  iterator operator -= (diff_t step) {
-    while(step-- > 0) {
-      --_this();
+    else {
+      for(; step > 0; --step) {
+        ++_this();
+      }
+
+      for(; step < 0; ++step) {
+        --_this();
+      }
     }
-    
+
     return _this();
   }
-  
-  iterator operator +(diff_t step) {
+
+  iterator &operator -= (diff_t step) {
+    return *this += -step;
+  }
+
+  iterator operator +(diff_t step) const {
     iterator new_ = _this();
-    
+
     return new_ += step;
   }
-  
-  iterator operator -(diff_t step) {
+
+  iterator operator -(diff_t step) const {
     iterator new_ = _this();
-    
+
     return new_ -= step;
   }
-  
-  diff_t operator -(iterator first) {
-    diff_t step = 0;
-    while(first != _this()) {
-      ++step;
-      ++first;
+
+  friend iterator operator +(diff_t step, const iterator &it) {
+    return it + step;
+  }
+
+  diff_t operator -(const iterator &first) const {
+    if constexpr (_itwrap::has_distance_to<T>::value) {
+      return first.distance_to(_this());
+    }
+    else {
+      diff_t step = 0;
+
+      iterator it = first;
+      while(it != _this()) {
+        ++step;
+        ++it;
+      }
+
+      return step;
     }
-    
-    return step;
   }
-  
-  iterator operator++() { _this().inc(); return _this(); }
-  iterator operator--() { _this().dec(); return _this(); }
-  
+
+  iterator &operator++() { _this().inc(); return _this(); }
+  iterator &operator--() { _this().dec(); return _this(); }
+
   iterator operator++(int) {
     iterator new_ = _this();
-    
+
     ++_this();
-    
+
     return new_;
   }
-  
+
   iterator operator--(int) {
     iterator new_ = _this();
-    
+
     --_this();
-    
+
     return new_;
   }
-  
+
   reference operator*() { return *_this().get(); }
-  const reference operator*() const { return *_this().get(); }
-  
+  const reference operator*() const { return *const_cast<iterator&>(_this()).get(); }
+
+  reference operator[](diff_t step) const { return *(_this() + step); }
+
   pointer operator->() { return &*_this(); }
   const pointer operator->() const { return &*_this(); }
-  
+
   bool operator != (const iterator &other) const {
     return !(_this() == other);
   }
-  
+
   bool operator < (const iterator &other) const {
     return !(_this() >= other);
   }
-  
+
   bool operator >= (const iterator &other) const {
     return _this() == other || _this() > other;
   }
-  
+
   bool operator <= (const iterator &other) const {
     return _this() == other || _this() < other;
   }
-  
+
   bool operator == (const iterator &other) const { return _this().eq(other); };
-  bool operator > (const iterator &other) const { return _this().gt(other); }
+
+  bool operator > (const iterator &other) const {
+    if constexpr (_itwrap::has_gt<T>::value) {
+      return _this().gt(other);
+    }
+    else {
+      return other.distance_to(_this()) > 0;
+    }
+  }
 private:
-  
+
   iterator &_this() { return *static_cast<iterator*>(this); }
   const iterator &_this() const { return *static_cast<const iterator*>(this); }
 };
@@ -2,15 +2,173 @@
 #define KITTY_UTIL_SET_H
 
 #include <tuple>
+#include <functional>
 #include <algorithm>
 #include <iterator>
 #include <vector>
 #include <utility>
 #include <type_traits>
 #include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <condition_variable>
 #include "optional.h"
+#include "view.h"
 
 namespace util {
+  namespace _set {
+    template<class Executor, class = void>
+    struct is_executor : std::false_type {};
+
+    // Anything with int post(Function), like ThreadPool
+    template<class Executor>
+    struct is_executor<Executor, std::void_t<decltype(std::declval<Executor&>().post(std::declval<void(*)()>()))>> : std::true_type {};
+
+    template<class Executor>
+    using enable_executor = std::enable_if_t<is_executor<std::remove_reference_t<Executor>>::value>;
+
+    /*
+     * Enough elements per chunk to fill a few pages,
+     * but enough chunks to keep every core busy when some chunks take longer.
+     */
+    template<class T>
+    std::size_t chunk_size(std::size_t size) {
+      std::size_t min_chunk = std::max<std::size_t>(1, 16384 / sizeof(T));
+      std::size_t chunks = 4 * std::max(1u, std::thread::hardware_concurrency());
+
+      return std::max(min_chunk, (size + chunks - 1) / chunks);
+    }
+
+    /*
+     * Calls f(chunk, begin, end) for every chunk of [0, size) on executor.
+     *
+     * The calling thread runs chunks as well, helpers only claim chunks nobody has started.
+     * Waiting never depends on a task still in the queue, so calling this from a worker of executor can't deadlock.
+     * The first exception thrown by f is rethrown.
+     */
+    template<class Executor, class Function>
+    void for_chunks(Executor &executor, std::size_t size, std::size_t chunk, Function &&f) {
+      struct state_t {
+        std::size_t size;
+        std::size_t chunk;
+        std::size_t chunks;
+        Function *f;
+
+        std::atomic<std::size_t> next;
+        std::atomic<std::size_t> done;
+
+        std::mutex lock;
+        std::condition_variable cv;
+        std::exception_ptr error;
+
+        void run() {
+          std::size_t x;
+          while((x = next.fetch_add(1)) < chunks) {
+            try {
+              (*f)(x, x * chunk, std::min(size, (x + 1) * chunk));
+            } catch(...) {
+              std::lock_guard<std::mutex> lg(lock);
+              if(!error) {
+                error = std::current_exception();
+              }
+            }
+
+            if(done.fetch_add(1) + 1 == chunks) {
+              std::lock_guard<std::mutex> lg(lock);
+              cv.notify_all();
+            }
+          }
+        }
+      };
+
+      auto state = std::make_shared<state_t>();
+      state->size   = size;
+      state->chunk  = chunk;
+      state->chunks = (size + chunk - 1) / chunk;
+      state->f      = &f;
+      state->next   = 0;
+      state->done   = 0;
+
+      // Helpers that start late find nothing left, they only keep state alive
+      std::size_t helpers = std::min<std::size_t>(state->chunks, std::max(1u, std::thread::hardware_concurrency())) - 1;
+      for(std::size_t x = 0; x < helpers; ++x) {
+        if(executor.post([state]() { state->run(); })) {
+          break;
+        }
+      }
+
+      state->run();
+
+      std::unique_lock<std::mutex> ul(state->lock);
+      state->cv.wait(ul, [&]() { return state->done.load() == state->chunks; });
+
+      if(state->error) {
+        std::rethrow_exception(state->error);
+      }
+    }
+
+    template<class It, class Function>
+    auto map_if(It begin, It end, Function &f, std::size_t reserve) {
+      typedef
+      typename std::remove_const<
+      typename std::remove_reference<decltype(*f(*begin))>::type
+      >::type output_t;
+
+      std::vector<output_t> result;
+      result.reserve(reserve);
+
+      for(;begin != end; ++begin) {
+        auto optional = f(*begin);
+
+        if(optional) {
+          result.emplace_back(std::move(*optional));
+        }
+      }
+
+      return result;
+    }
+
+    /*
+     * Runs per_chunk(first, last) in parallel over chunks of [begin, end)
+     * and concatenates the vectors it returns, in order.
+     */
+    template<class Executor, class It, class Function>
+    auto collect_chunks(Executor &executor, It begin, It end, Function &&per_chunk) {
+      static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value, "an executor requires random access iterators");
+
+      typedef decltype(per_chunk(begin, end)) chunk_t;
+
+      std::size_t size = std::distance(begin, end);
+      std::size_t chunk = chunk_size<typename std::iterator_traits<It>::value_type>(size);
+
+      if(size <= chunk) {
+        return per_chunk(begin, end);
+      }
+
+      std::vector<chunk_t> chunks((size + chunk - 1) / chunk);
+      for_chunks(executor, size, chunk, [&](std::size_t x, std::size_t first, std::size_t last) {
+        chunks[x] = per_chunk(begin + first, begin + last);
+      });
+
+      std::size_t total = 0;
+      for(auto &part : chunks) {
+        total += part.size();
+      }
+
+      chunk_t result;
+      result.reserve(total);
+
+      for(auto &part : chunks) {
+        std::move(std::begin(part), std::end(part), std::back_inserter(result));
+      }
+
+      return result;
+    }
+  }
+
   template<class It>
   auto concat(It begin, It end) {
     using Container = std::decay_t<decltype(*begin)>;
@@ -35,62 +193,119 @@ namespace util {
   
   template<class It, class Function>
   inline auto map_if(It begin, It end, Function &&f) {
-    typedef
-    typename std::remove_const<
-    typename std::remove_reference<decltype(*f(*begin))>::type
-    >::type output_t;
-    
-    std::vector<output_t> result;
-    result.reserve(std::distance(begin, end));
-    
-    for(;begin != end; ++begin) {
-      auto optional = f(*begin);
-      
-      if(optional) {
-        result.emplace_back(std::move(*optional));
-      }
-    }
-    
-    return result;
+    return _set::map_if(begin, end, f, std::distance(begin, end));
   }
   
   template<class From, class Function>
   inline auto map_if(From &&from, Function &&f) {
     return map_if(std::begin(from), std::end(from), std::forward<Function>(f));
   }
+
+  /*
+   * Like map_if, with chunks of the range running in parallel on executor
+   * The order of the output is the same as the order of the input
+   */
+  template<class Executor, class It, class Function, class = _set::enable_executor<Executor>>
+  inline auto map_if(Executor &executor, It begin, It end, Function &&f) {
+    return _set::collect_chunks(executor, begin, end, [&](It first, It last) {
+      return _set::map_if(first, last, f, std::distance(first, last));
+    });
+  }
+
+  template<class Executor, class From, class Function, class = _set::enable_executor<Executor>>
+  inline auto map_if(Executor &executor, From &&from, Function &&f) {
+    return map_if(executor, std::begin(from), std::end(from), std::forward<Function>(f));
+  }
   
   template<class It, class Function>
   inline auto map(It begin, It end, Function &&f) {
-    typedef decltype(*begin) input_t;
     typedef typename std::remove_const<
     typename std::remove_reference<decltype(f(*begin))>::type
     >::type output_t;
     
-    return map_if(begin, end, [&](input_t &input) {
-      return util::Optional<output_t> { f(input) };
-    });
+    return view::from(begin, end).map(std::ref(f)).template collect<std::vector<output_t>>();
   }
   
   template<class From, class Function>
   inline auto map(From &&from, Function &&f) {
     return map(std::begin(from), std::end(from), std::forward<Function>(f));
   }
-  
+
+  /*
+   * Like map, with chunks of the range running in parallel on executor
+   * The order of the output is the same as the order of the input
+   */
+  template<class Executor, class It, class Function, class = _set::enable_executor<Executor>>
+  inline auto map(Executor &executor, It begin, It end, Function &&f) {
+    return _set::collect_chunks(executor, begin, end, [&](It first, It last) {
+      return map(first, last, f);
+    });
+  }
+
+  template<class Executor, class From, class Function, class = _set::enable_executor<Executor>>
+  inline auto map(Executor &executor, From &&from, Function &&f) {
+    return map(executor, std::begin(from), std::end(from), std::forward<Function>(f));
+  }
+
+  /*
+   * f(begin[0], f(begin[1], ... f(end[-2], end[-1])))
+   * The range may not be empty
+   */
   template<class It, class Function>
   inline auto fold(It begin, It end, Function &&f) {
-    if(begin + 1 == end) {
-      return *begin;
+    --end;
+
+    std::decay_t<decltype(*end)> result = *end;
+    while(end != begin) {
+      --end;
+
+      result = f(*end, result);
     }
-    
-    auto result = fold(begin + 1, end, f);
-    
-    return f(*begin, result);
+
+    return result;
   }
   
   template<class From, class Function>
   inline auto fold(From &&from, Function &&f) {
     return fold(std::begin(from), std::end(from), std::forward<Function>(f));
   }
+
+  /*
+   * Like fold, with chunks of the range folded in parallel on executor.
+   * The results of the chunks are combined pairwise, so f must be associative.
+   */
+  template<class Executor, class It, class Function, class = _set::enable_executor<Executor>>
+  inline auto fold(Executor &executor, It begin, It end, Function &&f) {
+    static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value, "fold over an executor requires random access iterators");
+
+    typedef std::decay_t<decltype(*begin)> value_t;
+
+    std::size_t size = std::distance(begin, end);
+    std::size_t chunk = _set::chunk_size<value_t>(size);
+
+    if(size <= chunk) {
+      return fold(begin, end, f);
+    }
+
+    std::vector<util::Optional<value_t>> chunks((size + chunk - 1) / chunk);
+    _set::for_chunks(executor, size, chunk, [&](std::size_t x, std::size_t first, std::size_t last) {
+      chunks[x] = fold(begin + first, begin + last, f);
+    });
+
+    // Tree reduction, neighbours are combined so the order of the operands is kept
+    for(std::size_t step = 1; step < chunks.size(); step *= 2) {
+      for(std::size_t x = 0; x + step < chunks.size(); x += 2 * step) {
+        chunks[x] = f(*chunks[x], *chunks[x + step]);
+      }
+    }
+
+    return std::move(*chunks[0]);
+  }
+
+  template<class Executor, class From, class Function, class = _set::enable_executor<Executor>>
+  inline auto fold(Executor &executor, From &&from, Function &&f) {
+    return fold(executor, std::begin(from), std::end(from), std::forward<Function>(f));
+  }
   
   template<class Container, class Function>
   typename std::remove_reference<Container>::type
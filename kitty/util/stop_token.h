@@ -0,0 +1,54 @@
+#ifndef KITTY_UTIL_STOP_TOKEN_H
+#define KITTY_UTIL_STOP_TOKEN_H
+
+#include <atomic>
+#include <memory>
+
+namespace util {
+/*
+ * Cooperative cancellation, like std::stop_token in C++20.
+ *
+ * A StopSource hands out tokens that all observe the same request,
+ * a single StopSource can therefore cancel a whole group of tasks,
+ * e.g. all work on behalf of one client.
+ */
+class StopToken {
+  std::shared_ptr<const std::atomic<bool>> _stop;
+
+public:
+  // A token that is never stopped
+  StopToken() = default;
+  explicit StopToken(std::shared_ptr<const std::atomic<bool>> stop) : _stop(std::move(stop)) {}
+
+  bool stop_requested() const {
+    return _stop && _stop->load(std::memory_order_acquire);
+  }
+
+  bool stop_possible() const {
+    return (bool)_stop;
+  }
+};
+
+class StopSource {
+  std::shared_ptr<std::atomic<bool>> _stop;
+
+public:
+  StopSource() : _stop(std::make_shared<std::atomic<bool>>(false)) {}
+
+  StopToken token() const {
+    return StopToken { _stop };
+  }
+
+  /*
+   * @return true if this call made the request
+   */
+  bool request_stop() {
+    return !_stop->exchange(true, std::memory_order_acq_rel);
+  }
+
+  bool stop_requested() const {
+    return _stop->load(std::memory_order_acquire);
+  }
+};
+}
+#endif
@@ -0,0 +1,229 @@
+#ifndef KITTY_UTIL_TASK_GRAPH_H
+#define KITTY_UTIL_TASK_GRAPH_H
+
+#include <tuple>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include <initializer_list>
+
+#include <kitty/util/future.h>
+
+namespace util {
+/*
+ * A set of tasks and the tasks they wait for.
+ * A task only depends on tasks added before it, so the graph can't have cycles.
+ *
+ * run() posts each task to the executor as soon as its dependencies have finished,
+ * no worker blocks waiting for another task.
+ */
+class TaskGraph {
+public:
+  typedef std::size_t node_t;
+
+private:
+  struct node_info_t {
+    std::function<void()> task;
+
+    std::vector<node_t> dependents;
+    std::size_t dependencies;
+  };
+
+  std::vector<node_info_t> _nodes;
+
+  // The state of a single run, shared by the tasks in flight
+  struct run_t {
+    std::vector<node_info_t> nodes;
+
+    std::unique_ptr<std::atomic<std::size_t>[]> remaining;
+
+    // Set when a dependency failed, the node is then skipped
+    std::unique_ptr<std::atomic<bool>[]> failed;
+
+    std::atomic<std::size_t> unfinished;
+
+    std::atomic<bool> has_error;
+    std::exception_ptr error;
+
+    Promise<void> promise;
+  };
+
+public:
+  /*
+   * Add task, to run after all of dependencies
+   * @return The node of task, or -1 if a dependency doesn't exist
+   */
+  template<class Function>
+  node_t add(Function &&task, std::initializer_list<node_t> dependencies = {}) {
+    return add(std::forward<Function>(task), std::vector<node_t>(dependencies));
+  }
+
+  template<class Function>
+  node_t add(Function &&task, const std::vector<node_t> &dependencies) {
+    node_t node = _nodes.size();
+
+    for(auto dependency : dependencies) {
+      if(dependency >= node) {
+        err::code = err::OUT_OF_BOUNDS;
+
+        return (node_t)-1;
+      }
+    }
+
+    for(auto dependency : dependencies) {
+      _nodes[dependency].dependents.push_back(node);
+    }
+
+    _nodes.push_back(node_info_t { std::forward<Function>(task), {}, dependencies.size() });
+
+    return node;
+  }
+
+  std::size_t size() const {
+    return _nodes.size();
+  }
+
+  /*
+   * Run all tasks on executor, the graph may be run again afterwards.
+   * If a task throws, the tasks that depend on it are skipped and the first exception is passed on.
+   *
+   * @return The future that is ready once every task has finished or was skipped
+   */
+  template<class Executor>
+  Future<void> run(Executor &executor) const {
+    auto run = std::make_shared<run_t>();
+
+    auto future = run->promise.get_future();
+    if(_nodes.empty()) {
+      run->promise.set_value();
+
+      return future;
+    }
+
+    run->nodes = _nodes;
+    run->remaining = std::make_unique<std::atomic<std::size_t>[]>(_nodes.size());
+    run->failed    = std::make_unique<std::atomic<bool>[]>(_nodes.size());
+    run->unfinished = _nodes.size();
+    run->has_error  = false;
+
+    for(node_t node = 0; node < _nodes.size(); ++node) {
+      run->remaining[node] = _nodes[node].dependencies;
+      run->failed[node] = false;
+    }
+
+    for(node_t node = 0; node < _nodes.size(); ++node) {
+      if(!_nodes[node].dependencies && !_schedule(executor, run, node)) {
+        _finish(executor, run, node, false);
+      }
+    }
+
+    return future;
+  }
+
+private:
+  /*
+   * A node handed to the executor, shared by the copies of its task.
+   * If the executor discards the task without running it, the node fails with broken_promise.
+   */
+  template<class Executor>
+  struct pending_t {
+    Executor &executor;
+    std::shared_ptr<run_t> run;
+    node_t node;
+
+    bool done = false;
+
+    pending_t(Executor &executor, std::shared_ptr<run_t> run, node_t node) : executor(executor), run(std::move(run)), node(node) {}
+    pending_t(const pending_t&) = delete;
+
+    ~pending_t() {
+      if(!done) {
+        _fail(*run, std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        _finish(executor, run, node, false);
+      }
+    }
+  };
+
+  // @return false when the executor rejected node, it has failed then
+  template<class Executor>
+  static bool _schedule(Executor &executor, const std::shared_ptr<run_t> &run, node_t node) {
+    auto pending = std::make_shared<pending_t<Executor>>(executor, run, node);
+
+    int result = executor.post([pending]() {
+      pending->done = true;
+
+      auto &run = pending->run;
+      auto node = pending->node;
+
+      bool ok = true;
+      try {
+        run->nodes[node].task();
+      } catch(...) {
+        _fail(*run, std::current_exception());
+
+        ok = false;
+      }
+
+      _finish(pending->executor, run, node, ok);
+    });
+
+    if(result) {
+      pending->done = true;
+
+      _fail(*run, _future::rejected());
+      return false;
+    }
+
+    return true;
+  }
+
+  /*
+   * Schedule the dependents of node that are ready now.
+   * Skipped dependents finish right away, they go on a worklist so a long chain of them can't exhaust the stack.
+   */
+  template<class Executor>
+  static void _finish(Executor &executor, const std::shared_ptr<run_t> &run, node_t node, bool ok) {
+    std::vector<std::pair<node_t, bool>> finished { { node, ok } };
+
+    while(!finished.empty()) {
+      std::tie(node, ok) = finished.back();
+      finished.pop_back();
+
+      for(auto dependent : run->nodes[node].dependents) {
+        if(!ok) {
+          run->failed[dependent].store(true);
+        }
+
+        if(--run->remaining[dependent]) {
+          continue;
+        }
+
+        if(run->failed[dependent].load() || !_schedule(executor, run, dependent)) {
+          finished.emplace_back(dependent, false);
+        }
+      }
+
+      if(--run->unfinished) {
+        continue;
+      }
+
+      if(run->has_error.load()) {
+        run->promise.set_exception(run->error);
+      }
+      else {
+        run->promise.set_value();
+      }
+    }
+  }
+
+  static void _fail(run_t &run, std::exception_ptr error) {
+    if(!run.has_error.exchange(true)) {
+      run.error = std::move(error);
+    }
+  }
+};
+}
+#endif
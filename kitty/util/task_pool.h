@@ -2,16 +2,23 @@
 #define KITTY_TASK_POOL_H
 
 #include <deque>
+#include <tuple>
 #include <vector>
 #include <future>
 #include <chrono>
 #include <utility>
 #include <functional>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
 
+#include <condition_variable>
+
+#include <kitty/err/err.h>
 #include <kitty/util/optional.h>
 #include <kitty/util/utility.h>
 #include <kitty/util/thread_t.h>
+#include <kitty/util/stop_token.h>
 namespace util {
 
 class TaskPool {
@@ -22,72 +29,264 @@ public:
 
   typedef std::chrono::steady_clock::time_point __time_point;
 
+  // Index of a priority lane
+  typedef std::size_t lane_t;
+
+  enum schedule_t {
+    STRICT,  // Lane x is only served while lanes [0, x) are empty
+    WEIGHTED // Every non-empty lane is served in proportion to its weight
+  };
+
+  // What a push does when the pool is at capacity
+  enum overflow_t {
+    BLOCK,      // Wait until a task is popped
+    REJECT,     // Fail the push
+    DROP_OLDEST // Discard the oldest task of the lowest priority lane that has tasks
+  };
+
+  struct config_t {
+    // The weight of each lane, lane 0 has the highest priority
+    std::vector<std::uint32_t> lanes { 1 };
+    schedule_t schedule = STRICT;
+
+    // The lane used by push()
+    lane_t default_lane = 0;
+
+    // Discard tasks whose deadline passed before they could run
+    bool drop_expired = false;
+
+    // Maximum number of tasks waiting in the lanes, 0 for no limit
+    std::size_t capacity = 0;
+    overflow_t overflow = BLOCK;
+
+    /*
+     * CoDel style shedding, disabled while target is 0
+     * Once the time tasks spend queued stays above target for a full interval,
+     * pushes are rejected until a task is popped that waited less than target.
+     */
+    std::chrono::microseconds shed_target { 0 };
+    std::chrono::microseconds shed_interval { 100000 };
+  };
+
+  struct stats_t {
+    // Tasks that started after their deadline, or were dropped
+    std::uint64_t deadline_missed;
+
+    // Pushes rejected at capacity
+    std::uint64_t rejected;
+
+    // Tasks discarded by DROP_OLDEST
+    std::uint64_t dropped;
+
+    // Pushes rejected because tasks were queued for too long
+    std::uint64_t shed;
+
+    // Tasks discarded because their token was stopped before they could run
+    std::uint64_t cancelled;
+
+    // The time the last popped task spent queued
+    std::chrono::microseconds sojourn;
+  };
+
   template<class R>
   class timer_task_t {
   public:
     task_id_t task_id;
     std::future<R> future;
 
-    timer_task_t(task_id_t _task_id, std::future<R> &future) : task_id(_task_id) {
-      this->future.swap(future);
-    }
+    timer_task_t(task_id_t _task_id, std::future<R> &future) : task_id(_task_id), future(std::move(future)) {}
   };
 protected:
-  std::deque<__task> _tasks;
-  std::vector<std::pair<__time_point, __task>> _timer_tasks; 
+  struct queued_task_t {
+    __time_point deadline;
+    __time_point enqueued;
+    __task task;
+
+    // A stopped task is left in place and discarded once it's reached
+    StopToken token;
+
+    // Used with a max-heap, the earliest deadline must compare greatest
+    bool operator<(const queued_task_t &other) const {
+      return deadline > other.deadline;
+    }
+  };
+
+  struct lane_queue_t {
+    // Tasks with a deadline run first, earliest deadline first
+    std::vector<queued_task_t> deadline;
+    std::deque<queued_task_t> fifo;
+
+    std::int64_t weight;
+    std::int64_t current;
+
+    bool empty() const {
+      return deadline.empty() && fifo.empty();
+    }
+  };
+
+  config_t _config;
+
+  std::vector<lane_queue_t> _lanes;
+  // Sorted on time_point, the first task to run is at the back
+  std::vector<std::tuple<__time_point, __task, StopToken>> _timer_tasks;
   std::mutex _task_mutex;
 
+  // Stopped timer tasks are removed from the middle of _timer_tasks once it grows this large
+  std::size_t _timer_purge_at = 64;
+
+  // Number of tasks in _lanes, readable without taking _task_mutex
+  std::atomic<std::size_t> _pending { 0 };
+
+  // Pushes waiting for capacity
+  std::condition_variable _space;
+  std::size_t _blocked = 0;
+
+  // Set once sojourn times have been above shed_target for shed_interval
+  bool _shedding = false;
+  __time_point _above_since {};
+
+  stats_t _stats {};
+
+  /*
+   * Tasks discarded while holding _task_mutex, destroyed once it's released.
+   * Destroying a task breaks the promise of its future, whose continuations may post to this pool.
+   */
+  std::vector<__task> _discarded;
+
 public:
+  TaskPool() : TaskPool(config_t {}) {}
+
+  TaskPool(config_t config) : _config(std::move(config)) {
+    if(_config.lanes.empty()) {
+      _config.lanes.emplace_back(1);
+    }
+
+    // lane_queue_t can't be moved without the risk of throwing, so no growing
+    _lanes = std::vector<lane_queue_t>(_config.lanes.size());
+    for(std::size_t x = 0; x < _lanes.size(); ++x) {
+      _lanes[x].weight  = std::max<std::int64_t>(1, _config.lanes[x]);
+      _lanes[x].current = 0;
+    }
+
+    _config.default_lane = std::min(_config.default_lane, _lanes.size() - 1);
+  }
+
   template<class Function, class... Args>
   auto push(Function && newTask, Args &&... args) {
-    typedef decltype(newTask(std::forward<Args>(args)...)) __return;
-    typedef std::packaged_task<__return()> task_t;
-    
-    task_t task(std::bind(
-      std::forward<Function>(newTask),
-      std::forward<Args>(args)...
-    ));
-    
-    auto future = task.get_future();
-    
-    std::lock_guard<std::mutex> lg(_task_mutex);
-    _tasks.emplace_back(toRunnable(std::move(task)));
-    
-    return future;
+    return pushLane(std::forward<Function>(newTask), _config.default_lane, std::forward<Args>(args)...);
   }
 
   /**
-   * @return an id to potentially delay the task
+   * Like push, without the cost of a future
+   *
+   * @return -1 if rejected, err::code is set to err::OVERLOADED
    */
-  template<class Function, class X, class Y, class... Args>
-  auto pushDelayed(Function &&newTask, std::chrono::duration<X, Y> duration, Args &&... args) {
-    typedef decltype(newTask(std::forward<Args>(args)...)) __return;
-    typedef std::packaged_task<__return()> task_t;
-    
-    __time_point time_point = std::chrono::steady_clock::now() + duration;
-
-    task_t task(std::bind(
+  template<class Function, class... Args>
+  int post(Function && newTask, Args &&... args) {
+    return _enqueue(_config.default_lane, __time_point::max(), toRunnable(std::bind(
       std::forward<Function>(newTask),
       std::forward<Args>(args)...
-    ));
+    )));
+  }
 
-    auto future = task.get_future();
-    
-    std::lock_guard<std::mutex> lg(_task_mutex);
-    
-    auto it = _timer_tasks.cbegin();
-    for(; it < _timer_tasks.cend(); ++it) {
-      if(std::get<0>(*it) < time_point) {
+  /**
+   * Post the callables in [first, last) to the default lane, taking the lock once.
+   * Stops before the first task that would have to wait for capacity under BLOCK,
+   * so the caller can wake the workers first.
+   *
+   * @param rejected Incremented for every task that was rejected
+   * @return The first task that wasn't posted, last if all were
+   */
+  template<class It>
+  It postRange(It first, It last, std::size_t &rejected) {
+    auto now = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> ul(_task_mutex);
+    for(; first != last; ++first) {
+      if(_config.capacity && _config.overflow == BLOCK && _pending.load(std::memory_order_relaxed) >= _config.capacity) {
         break;
       }
+
+      if(_admit(ul)) {
+        ++rejected;
+        continue;
+      }
+
+      _lane(_config.default_lane).fifo.emplace_back(queued_task_t { __time_point::max(), now, toRunnable(std::move(*first)), StopToken {} });
+      _pending.fetch_add(1, std::memory_order_relaxed);
     }
 
-    auto runnable = toRunnable(std::move(task));
+    _dispose(ul);
+    return first;
+  }
 
-    task_id_t task_id = &*runnable;
-    _timer_tasks.emplace(it, time_point, std::move(runnable));
+  /**
+   * On rejection the returned future is invalid and err::code is set to err::OVERLOADED
+   *
+   * @param lane The priority lane, out of range lanes are clamped to the last lane
+   */
+  template<class Function, class... Args>
+  auto pushLane(Function && newTask, lane_t lane, Args &&... args) {
+    auto task = _package(std::forward<Function>(newTask), std::forward<Args>(args)...);
+    
+    return _enqueue(lane, __time_point::max(), std::move(task));
+  }
+
+  /**
+   * Within its lane, the task runs before tasks with a later or no deadline
+   * On rejection the returned future is invalid and err::code is set to err::OVERLOADED
+   *
+   * @param deadline The time before which the task should have started
+   */
+  template<class Function, class... Args>
+  auto pushDeadline(Function && newTask, lane_t lane, __time_point deadline, Args &&... args) {
+    auto task = _package(std::forward<Function>(newTask), std::forward<Args>(args)...);
+
+    return _enqueue(lane, deadline, std::move(task));
+  }
+
+  /**
+   * @param duration The time from now before which the task should have started
+   */
+  template<class Function, class X, class Y, class... Args>
+  auto pushDeadline(Function && newTask, lane_t lane, std::chrono::duration<X, Y> duration, Args &&... args) {
+    return pushDeadline(std::forward<Function>(newTask), lane, std::chrono::steady_clock::now() + duration, std::forward<Args>(args)...);
+  }
+
+  /**
+   * Once token is stopped, the task is discarded instead of run and its future throws std::future_error.
+   * If newTask can be called with the token as its first argument, the token is passed on,
+   * so a task that has already started can stop early.
+   *
+   * A single StopSource cancels all tasks pushed with its tokens.
+   * Cancelling is lazy: the task leaves the queue, and its future fails, once it's reached or the queue is purged.
+   */
+  template<class Function, class... Args>
+  auto pushStoppable(Function && newTask, StopToken token, Args &&... args) {
+    auto task = _packageStoppable(std::forward<Function>(newTask), token, std::forward<Args>(args)...);
 
-    return timer_task_t<__return> { task_id, future };
+    return _enqueue(_config.default_lane, __time_point::max(), std::move(task), std::move(token));
+  }
+
+  /**
+   * @return an id to potentially delay the task
+   */
+  template<class Function, class X, class Y, class... Args>
+  auto pushDelayed(Function &&newTask, std::chrono::duration<X, Y> duration, Args &&... args) {
+    auto task = _package(std::forward<Function>(newTask), std::forward<Args>(args)...);
+
+    return _enqueueDelayed(std::chrono::steady_clock::now() + duration, std::move(task), StopToken {});
+  }
+
+  /**
+   * Like pushDelayed, the task is discarded if token is stopped before it runs
+   * A stopped timer is discarded once it's due or the timers are purged, its future stays pending until then
+   */
+  template<class Function, class X, class Y, class... Args>
+  auto pushDelayedStoppable(Function &&newTask, std::chrono::duration<X, Y> duration, StopToken token, Args &&... args) {
+    auto task = _packageStoppable(std::forward<Function>(newTask), token, std::forward<Args>(args)...);
+
+    return _enqueueDelayed(std::chrono::steady_clock::now() + duration, std::move(task), std::move(token));
   }
 
   /**
@@ -123,29 +322,192 @@ public:
     }
   }
 
+  /**
+   * Searches all delayed tasks, prefer pushDelayedStoppable() for cancelling many tasks
+   */
   void cancel(task_id_t task_id) {
-    std::lock_guard<std::mutex> lg(_task_mutex);
+    std::unique_lock<std::mutex> ul(_task_mutex);
 
     auto it = _timer_tasks.begin();
     for(; it < _timer_tasks.cend(); ++it) {
-      const __task &task = std::get<1>(*it);
+      __task &task = std::get<1>(*it);
 
       if(&*task == task_id) {
+        _discarded.emplace_back(std::move(task));
         _timer_tasks.erase(it);
+
+        break;
       }
     }
+
+    _dispose(ul);
   }
     
   util::Optional<__task> pop() {
+    std::unique_lock<std::mutex> ul(_task_mutex);
+
+    auto task = _pop();
+    _dispose(ul);
+
+    return task;
+  }
+
+  bool ready() {
+    std::unique_lock<std::mutex> ul(_task_mutex);
+
+    bool ready = _pending.load(std::memory_order_relaxed) || _timerReady();
+    _dispose(ul);
+
+    return ready;
+  }
+
+  stats_t stats() {
     std::lock_guard<std::mutex> lg(_task_mutex);
-    
-    if(!_tasks.empty()) {
-      __task task = std::move(_tasks.front());
-      _tasks.pop_front();
-      return std::move(task);
+
+    return _stats;
+  }
+
+  std::size_t lanes() const {
+    return _lanes.size();
+  }
+
+  /**
+   * The oldest task is searched among the FIFO fronts and the most urgent deadline task of each lane
+   *
+   * @return The time the oldest waiting task was pushed
+   */
+  std::optional<__time_point> oldest() {
+    std::lock_guard<std::mutex> lg(_task_mutex);
+
+    std::optional<__time_point> oldest;
+    for(auto &lane : _lanes) {
+      if(!lane.fifo.empty() && (!oldest || lane.fifo.front().enqueued < *oldest)) {
+        oldest = lane.fifo.front().enqueued;
+      }
+
+      if(!lane.deadline.empty() && (!oldest || lane.deadline.front().enqueued < *oldest)) {
+        oldest = lane.deadline.front().enqueued;
+      }
+    }
+
+    return oldest;
+  }
+
+  /**
+   * @return A hint of the number of tasks ready for immediate execution, without locking
+   */
+  std::size_t pending() const {
+    return _pending.load(std::memory_order_relaxed);
+  }
+
+  std::optional<__time_point> next() {
+    std::unique_lock<std::mutex> ul(_task_mutex);
+
+    // Don't let anyone wait for a task that won't run
+    _popStoppedTimers();
+
+    std::optional<__time_point> next;
+    if(!_timer_tasks.empty()) {
+      next = std::get<0>(_timer_tasks.back());
+    }
+
+    _dispose(ul);
+    return next;
+  }
+private:
+  template<class R>
+  std::future<R> _enqueue(lane_t lane, __time_point deadline, std::packaged_task<R()> &&task, StopToken token = {}) {
+    auto future = task.get_future();
+
+    if(_enqueue(lane, deadline, toRunnable(std::move(task)), std::move(token))) {
+      return {};
+    }
+
+    return future;
+  }
+
+  int _enqueue(lane_t lane_id, __time_point deadline, __task &&task, StopToken token = {}) {
+    auto now = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> ul(_task_mutex);
+    if(_admit(ul)) {
+      _dispose(ul);
+
+      err::code = err::OVERLOADED;
+      return -1;
+    }
+
+    auto &lane = _lane(lane_id);
+
+    if(deadline == __time_point::max()) {
+      lane.fifo.emplace_back(queued_task_t { deadline, now, std::move(task), std::move(token) });
+    }
+    else {
+      lane.deadline.emplace_back(queued_task_t { deadline, now, std::move(task), std::move(token) });
+      std::push_heap(std::begin(lane.deadline), std::end(lane.deadline));
+    }
+
+    _pending.fetch_add(1, std::memory_order_relaxed);
+
+    _dispose(ul);
+    return 0;
+  }
+
+  template<class R>
+  timer_task_t<R> _enqueueDelayed(__time_point time_point, std::packaged_task<R()> &&task, StopToken token) {
+    auto future = task.get_future();
+
+    std::unique_lock<std::mutex> ul(_task_mutex);
+
+    if(_timer_tasks.size() >= _timer_purge_at) {
+      _purgeStoppedTimers();
+    }
+
+    auto it = _timer_tasks.cbegin();
+    for(; it < _timer_tasks.cend(); ++it) {
+      if(std::get<0>(*it) < time_point) {
+        break;
+      }
+    }
+
+    auto runnable = toRunnable(std::move(task));
+
+    task_id_t task_id = &*runnable;
+    _timer_tasks.emplace(it, time_point, std::move(runnable), std::move(token));
+
+    _dispose(ul);
+    return timer_task_t<R> { task_id, future };
+  }
+
+  // Requires _task_mutex
+  util::Optional<__task> _pop() {
+    while(_pending.load(std::memory_order_relaxed)) {
+      auto &lane = _next_lane();
+      auto task = _take(lane);
+
+      if(task.token.stop_requested()) {
+        ++_stats.cancelled;
+
+        _discarded.emplace_back(std::move(task.task));
+        continue;
+      }
+
+      auto now = std::chrono::steady_clock::now();
+      _sojourn(now - task.enqueued, now);
+
+      if(task.deadline < now) {
+        ++_stats.deadline_missed;
+
+        if(_config.drop_expired) {
+          _discarded.emplace_back(std::move(task.task));
+          continue;
+        }
+      }
+
+      return std::move(task.task);
     }
     
-    if(!_timer_tasks.empty() && std::get<0>(_timer_tasks.back()) <= std::chrono::steady_clock::now()) {
+    if(_timerReady()) {
       __task task = std::move(std::get<1>(_timer_tasks.back()));
       _timer_tasks.pop_back();
       
@@ -155,23 +517,253 @@ public:
     return {};
   }
 
-  bool ready() {
-    std::lock_guard<std::mutex> lg(_task_mutex);
+  // Destroy the tasks discarded while holding _task_mutex, after releasing it
+  void _dispose(std::unique_lock<std::mutex> &ul) {
+    if(_discarded.empty()) {
+      return;
+    }
+
+    auto discarded = std::move(_discarded);
+    _discarded.clear();
 
-    return !_tasks.empty() || (!_timer_tasks.empty() && std::get<0>(_timer_tasks.back()) <= std::chrono::steady_clock::now());
+    ul.unlock();
   }
 
-  std::optional<__time_point> next() {
-    std::lock_guard<std::mutex> lg(_task_mutex);
+  // Requires _task_mutex, @return true if the timer task at the back is due
+  bool _timerReady() {
+    _popStoppedTimers();
+
+    return !_timer_tasks.empty() && std::get<0>(_timer_tasks.back()) <= std::chrono::steady_clock::now();
+  }
+
+  // Requires _task_mutex
+  void _popStoppedTimers() {
+    while(!_timer_tasks.empty() && std::get<2>(_timer_tasks.back()).stop_requested()) {
+      _discarded.emplace_back(std::move(std::get<1>(_timer_tasks.back())));
+      _timer_tasks.pop_back();
 
-    if(_timer_tasks.empty()) {
-      return std::nullopt;
+      ++_stats.cancelled;
     }
+  }
+
+  /*
+   * Requires _task_mutex
+   * Only runs when the timers doubled since the last purge, keeping the cost per push constant
+   */
+  void _purgeStoppedTimers() {
+    auto size = _timer_tasks.size();
 
-    return std::get<0>(_timer_tasks.back());
+    for(auto &timer : _timer_tasks) {
+      if(std::get<2>(timer).stop_requested()) {
+        _discarded.emplace_back(std::move(std::get<1>(timer)));
+      }
+    }
+
+    // A token may be stopped meanwhile, only the tasks that were moved out are removed
+    _timer_tasks.erase(std::remove_if(std::begin(_timer_tasks), std::end(_timer_tasks), [](const auto &timer) {
+      return !std::get<1>(timer);
+    }), std::end(_timer_tasks));
+
+    _stats.cancelled += size - _timer_tasks.size();
+    _timer_purge_at = std::max<std::size_t>(64, _timer_tasks.size() * 2);
+  }
+
+  /*
+   * Requires _task_mutex
+   * Remove the stopped tasks from the lanes, when they'd otherwise take up capacity
+   */
+  void _purgeStopped() {
+    auto stopped = [](const queued_task_t &task) { return task.token.stop_requested(); };
+
+    // A token may be stopped meanwhile, only the tasks that were moved out are removed
+    auto discarded = [](const queued_task_t &task) { return !task.task; };
+
+    std::size_t removed = 0;
+    for(auto &lane : _lanes) {
+      for(auto &task : lane.fifo) {
+        if(stopped(task)) {
+          _discarded.emplace_back(std::move(task.task));
+        }
+      }
+
+      for(auto &task : lane.deadline) {
+        if(stopped(task)) {
+          _discarded.emplace_back(std::move(task.task));
+        }
+      }
+
+      auto fifo_size = lane.fifo.size();
+      lane.fifo.erase(std::remove_if(std::begin(lane.fifo), std::end(lane.fifo), discarded), std::end(lane.fifo));
+
+      auto deadline_size = lane.deadline.size();
+      lane.deadline.erase(std::remove_if(std::begin(lane.deadline), std::end(lane.deadline), discarded), std::end(lane.deadline));
+      std::make_heap(std::begin(lane.deadline), std::end(lane.deadline));
+
+      removed += fifo_size - lane.fifo.size() + deadline_size - lane.deadline.size();
+    }
+
+    _pending.fetch_sub(removed, std::memory_order_relaxed);
+    _stats.cancelled += removed;
+  }
+
+  // @return non-zero if the push must be rejected
+  int _admit(std::unique_lock<std::mutex> &ul) {
+    if(_shedding) {
+      // An empty queue means nothing is delayed anymore
+      if(_pending.load(std::memory_order_relaxed)) {
+        ++_stats.shed;
+
+        return -1;
+      }
+
+      _shedding = false;
+      _above_since = {};
+    }
+
+    if(!_config.capacity) {
+      return 0;
+    }
+
+    if(_pending.load(std::memory_order_relaxed) >= _config.capacity) {
+      _purgeStopped();
+    }
+
+    while(_pending.load(std::memory_order_relaxed) >= _config.capacity) {
+      switch(_config.overflow) {
+        case BLOCK:
+          ++_blocked;
+          _space.wait(ul);
+          --_blocked;
+
+          break;
+        case REJECT:
+          ++_stats.rejected;
+
+          return -1;
+        case DROP_OLDEST:
+          for(auto lane = _lanes.rbegin(); lane != _lanes.rend(); ++lane) {
+            if(lane->empty()) {
+              continue;
+            }
+
+            // Its future is broken once the lock is released
+            if(lane->fifo.empty()) {
+              _discarded.emplace_back(std::move(_take(*lane).task));
+            }
+            else {
+              _discarded.emplace_back(std::move(lane->fifo.front().task));
+
+              lane->fifo.pop_front();
+              _pending.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            ++_stats.dropped;
+            break;
+          }
+
+          break;
+      }
+    }
+
+    return 0;
+  }
+
+  // Remove the next task from a non-empty lane
+  queued_task_t _take(lane_queue_t &lane) {
+    queued_task_t task;
+
+    if(lane.deadline.empty()) {
+      task = std::move(lane.fifo.front());
+      lane.fifo.pop_front();
+    }
+    else {
+      std::pop_heap(std::begin(lane.deadline), std::end(lane.deadline));
+      task = std::move(lane.deadline.back());
+      lane.deadline.pop_back();
+    }
+
+    _pending.fetch_sub(1, std::memory_order_relaxed);
+    if(_blocked) {
+      _space.notify_one();
+    }
+
+    return task;
+  }
+
+  void _sojourn(__time_point::duration sojourn, __time_point now) {
+    _stats.sojourn = std::chrono::duration_cast<std::chrono::microseconds>(sojourn);
+
+    if(!_config.shed_target.count()) {
+      return;
+    }
+
+    if(sojourn < _config.shed_target) {
+      _shedding = false;
+      _above_since = {};
+    }
+    else if(_above_since == __time_point {}) {
+      _above_since = now;
+    }
+    else if(now - _above_since >= _config.shed_interval) {
+      _shedding = true;
+    }
+  }
+
+  lane_queue_t &_lane(lane_t lane) {
+    return _lanes[std::min(lane, _lanes.size() - 1)];
+  }
+
+  // Requires a non-empty lane
+  lane_queue_t &_next_lane() {
+    if(_config.schedule == STRICT) {
+      for(auto &lane : _lanes) {
+        if(!lane.empty()) {
+          return lane;
+        }
+      }
+    }
+
+    // Smooth weighted round-robin over the non-empty lanes
+    lane_queue_t *best = nullptr;
+    std::int64_t total = 0;
+    for(auto &lane : _lanes) {
+      if(lane.empty()) {
+        continue;
+      }
+
+      lane.current += lane.weight;
+      total += lane.weight;
+
+      if(!best || lane.current > best->current) {
+        best = &lane;
+      }
+    }
+
+    best->current -= total;
+    return *best;
+  }
+
+  template<class Function, class... Args>
+  static auto _package(Function && newTask, Args &&... args) {
+    typedef decltype(newTask(std::forward<Args>(args)...)) __return;
+
+    return std::packaged_task<__return()>(std::bind(
+      std::forward<Function>(newTask),
+      std::forward<Args>(args)...
+    ));
   }
-private:
   
+  // The token is passed as the first argument, if newTask accepts it
+  template<class Function, class... Args>
+  static auto _packageStoppable(Function && newTask, const StopToken &token, Args &&... args) {
+    if constexpr (std::is_invocable<Function&, const StopToken&, Args&...>::value) {
+      return _package(std::forward<Function>(newTask), token, std::forward<Args>(args)...);
+    }
+    else {
+      return _package(std::forward<Function>(newTask), std::forward<Args>(args)...);
+    }
+  }
+
   template<class Function>
   std::unique_ptr<_ImplBase> toRunnable(Function &&f) {
     return std::make_unique<_Impl<Function>>(std::forward<Function&&>(f));
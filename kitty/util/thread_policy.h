@@ -0,0 +1,267 @@
+#ifndef KITTY_UTIL_THREAD_POLICY_H
+#define KITTY_UTIL_THREAD_POLICY_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <fstream>
+#include <functional>
+
+#include <cerrno>
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <kitty/util/thread_t.h>
+
+namespace util {
+/*
+ * How a pool places and sizes its threads.
+ * The default policy leaves everything to the OS.
+ */
+struct thread_policy_t {
+  enum affinity_t {
+    NONE,
+    PINNED,   // Thread x is pinned to cpus[x], filling one node before the next
+    SPREAD,   // Thread x is pinned to a single cpu, alternating between NUMA nodes
+    NUMA_NODE // Thread x may run on any cpu of its NUMA node
+  };
+
+  affinity_t affinity = NONE;
+
+  // The cpus to choose from, empty for all cpus the process may run on
+  std::vector<int> cpus;
+
+  // For NUMA_NODE, -1 divides the threads over all nodes
+  int numa_node = -1;
+
+  // 0 keeps the default stack size
+  std::size_t stack_size = 0;
+
+  // Threads are named "<name>/<index>", visible in top and perf
+  std::string name;
+
+  // Called from the new thread, after it's been placed
+  // State the thread allocates here is first touched on its own NUMA node
+  std::function<void(std::size_t index)> on_start;
+};
+
+namespace _thread_policy {
+inline std::vector<int> parse_cpulist(const std::string &list) {
+  std::vector<int> cpus;
+
+  std::size_t pos = 0;
+  while(pos < list.size()) {
+    std::size_t end = list.find(',', pos);
+    if(end == std::string::npos) {
+      end = list.size();
+    }
+
+    auto range = list.substr(pos, end - pos);
+    auto dash = range.find('-');
+
+    if(!range.empty() && range[0] >= '0' && range[0] <= '9') {
+      int first = std::stoi(range);
+      int last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+      for(int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    }
+
+    pos = end + 1;
+  }
+
+  return cpus;
+}
+
+inline std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  if(!sched_getaffinity(0, sizeof(set), &set)) {
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if(CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+
+  if(cpus.empty()) {
+    for(int cpu = 0; cpu < (int)std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  return cpus;
+}
+
+inline bool contains(const std::vector<int> &cpus, int cpu) {
+  return std::find(std::begin(cpus), std::end(cpus), cpu) != std::end(cpus);
+}
+}
+
+/*
+ * @return The cpus of each NUMA node, restricted to cpus.
+ * Without NUMA information, all cpus belong to a single node.
+ */
+inline std::vector<std::vector<int>> numa_nodes(const std::vector<int> &cpus) {
+  std::vector<std::vector<int>> nodes;
+
+#ifdef __linux__
+  for(int node = 0;; ++node) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+
+    if(!in) {
+      break;
+    }
+
+    std::string list;
+    std::getline(in, list);
+
+    std::vector<int> node_cpus;
+    for(auto cpu : _thread_policy::parse_cpulist(list)) {
+      if(_thread_policy::contains(cpus, cpu)) {
+        node_cpus.push_back(cpu);
+      }
+    }
+
+    if(!node_cpus.empty()) {
+      nodes.emplace_back(std::move(node_cpus));
+    }
+  }
+#endif
+
+  if(nodes.empty()) {
+    nodes.emplace_back(cpus);
+  }
+
+  return nodes;
+}
+
+/*
+ * @return The node of cpu among numa_nodes(cpus), as thread_policy_t::numa_node expects it
+ *         cpus is empty for all cpus the process may run on
+ */
+inline int numa_node_of(int cpu, const std::vector<int> &cpus = {}) {
+  auto nodes = numa_nodes(cpus.empty() ? _thread_policy::allowed_cpus() : cpus);
+
+  for(std::size_t node = 0; node < nodes.size(); ++node) {
+    if(_thread_policy::contains(nodes[node], cpu)) {
+      return (int)node;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * @return The cpus thread index may run on under policy, empty for no restriction
+ */
+inline std::vector<int> policy_cpus(const thread_policy_t &policy, std::size_t index) {
+  if(policy.affinity == thread_policy_t::NONE) {
+    return {};
+  }
+
+  auto cpus  = policy.cpus.empty() ? _thread_policy::allowed_cpus() : policy.cpus;
+  auto nodes = numa_nodes(cpus);
+
+  switch(policy.affinity) {
+    case thread_policy_t::PINNED: {
+      std::vector<int> compact;
+      for(auto &node : nodes) {
+        compact.insert(std::end(compact), std::begin(node), std::end(node));
+      }
+
+      return { compact[index % compact.size()] };
+    }
+    case thread_policy_t::SPREAD: {
+      auto &node = nodes[index % nodes.size()];
+
+      return { node[(index / nodes.size()) % node.size()] };
+    }
+    case thread_policy_t::NUMA_NODE:
+      if(policy.numa_node >= 0) {
+        return nodes[policy.numa_node % nodes.size()];
+      }
+
+      return nodes[index % nodes.size()];
+    case thread_policy_t::NONE:
+      break;
+  }
+
+  return {};
+}
+
+/*
+ * Apply policy to the calling thread
+ * On failure, the thread keeps running unplaced and -1 is returned
+ */
+inline int apply_thread_policy(const thread_policy_t &policy, std::size_t index) {
+  int result = 0;
+
+  if(!policy.name.empty()) {
+    // The kernel limits names to 15 characters, keep the index visible
+    auto suffix = '/' + std::to_string(index);
+    auto name   = policy.name.substr(0, 15 - std::min<std::size_t>(15, suffix.size())) + suffix;
+
+#ifdef __APPLE__
+    pthread_setname_np(name.c_str());
+#else
+    pthread_setname_np(pthread_self(), name.c_str());
+#endif
+  }
+
+#ifdef __linux__
+  auto cpus = policy_cpus(policy, index);
+  if(!cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for(auto cpu : cpus) {
+      CPU_SET(cpu, &set);
+    }
+
+    if(int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+      errno = error;
+      err::code = err::LIB_SYS;
+
+      result = -1;
+    }
+  }
+#endif
+
+  if(policy.on_start) {
+    policy.on_start(index);
+  }
+
+  return result;
+}
+
+/*
+ * Create threads according to a thread_policy_t
+ * Thread types that can't be given a stack size ignore policy.stack_size
+ */
+template<class Thread>
+struct thread_factory {
+  template<class Function>
+  static Thread spawn(const thread_policy_t &, Function &&f) {
+    return Thread(std::forward<Function>(f));
+  }
+};
+
+template<>
+struct thread_factory<native_thread_t> {
+  template<class Function>
+  static native_thread_t spawn(const thread_policy_t &policy, Function &&f) {
+    return native_thread_t(native_thread_t::attr_t { policy.stack_size }, std::forward<Function>(f));
+  }
+};
+}
+#endif
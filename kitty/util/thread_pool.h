@@ -1,31 +1,117 @@
 #ifndef KITTY_THREAD_POOL_H
 #define KITTY_THREAD_POOL_H
 
+#include <algorithm>
+
 #include <kitty/util/task_pool.h>
 #include <kitty/util/thread_t.h>
+#include <kitty/util/thread_policy.h>
+#include <kitty/util/event_count.h>
 
 namespace util {
 /*
  * Allow threads to execute unhindered
  * while keeping full controll over the threads.
+ *
+ * Placement, stack size and names of the threads are set by a thread_policy_t
  */
 template<class Thread = thread_t>
 class ThreadPoolWith : public TaskPool {
 public:
   typedef TaskPool::__task __task;
-  
+
+  // Bounds for the number of polls a worker makes before it parks
+  static constexpr std::uint32_t SPIN_MIN = 16;
+  static constexpr std::uint32_t SPIN_MAX = 4096;
+
+  /*
+   * Bounds for a pool that sizes itself.
+   * A worker is added when the oldest waiting task has waited longer than threshold,
+   * a worker is retired when it has been idle for keep_alive.
+   */
+  struct elastic_t {
+    std::size_t min;
+    std::size_t max;
+
+    std::chrono::microseconds threshold { 1000 };
+    std::chrono::milliseconds keep_alive { 60000 };
+  };
+
+  struct worker_stats_t {
+    // Workers currently running
+    std::size_t live;
+
+    // Workers parked, waiting for tasks
+    std::size_t idle;
+
+    // Workers added or retired because of the queueing delay
+    std::uint64_t grown;
+    std::uint64_t retired;
+  };
+
 private:
+  thread_policy_t _policy;
+  elastic_t _elastic;
+
+  // One slot per potential worker, guarded by _scale_lock
   std::vector<Thread> _thread;
 
-  std::condition_variable _cv;
-  std::mutex _lock;
-  
+  // Slots of retired workers, the first _used slots have been used
+  std::vector<std::size_t> _free;
+  std::size_t _used;
+
+  std::mutex _scale_lock;
+
+  std::atomic<std::size_t> _live;
+  std::atomic<bool> _growing;
+  std::atomic<std::uint64_t> _grown;
+  std::atomic<std::uint64_t> _retired;
+
+  EventCount _event;
+
+  // Grows the pool while every worker is busy, pushes only see tasks that are already late
+  Thread _monitor;
+  EventCount _overdue;
+
+  // Set while the monitor waits for a push rather than for a deadline
+  std::atomic<bool> _monitor_idle;
+
+  // Workers polling the queue, pushes don't need to wake anyone while > 0
+  std::atomic<std::uint32_t> _spinning;
+  std::uint32_t _max_spinning;
+
   std::atomic<bool> _continue;
 public:
 
-  ThreadPoolWith(int threads) : _thread(threads), _continue(true) {
-    for (auto & t : _thread) {
-      t = Thread(&ThreadPoolWith::_main, this);
+  ThreadPoolWith(int threads, thread_policy_t policy = {}, TaskPool::config_t config = {})
+    : ThreadPoolWith(elastic_t { (std::size_t)threads, (std::size_t)threads }, std::move(policy), std::move(config)) {}
+
+  /*
+   * Start with elastic.min workers and grow up to elastic.max workers
+   */
+  ThreadPoolWith(elastic_t elastic, thread_policy_t policy = {}, TaskPool::config_t config = {})
+    : TaskPool(std::move(config)), _policy(std::move(policy)), _elastic(elastic), _used(0), _live(0), _growing(false), _grown(0), _retired(0), _monitor_idle(false), _spinning(0), _continue(true) {
+
+    // Without a worker, nothing would be left to notice the queue growing
+    _elastic.min = std::max<std::size_t>(1, _elastic.min);
+    _elastic.max = std::max(_elastic.min, _elastic.max);
+
+    _thread = std::vector<Thread>(_elastic.max);
+
+    // Spinning on a single core only delays the thread that would push the task
+    _max_spinning = std::thread::hardware_concurrency() > 1 ? std::max<std::uint32_t>(1, _elastic.max / 2) : 0;
+
+    {
+      std::lock_guard<std::mutex> lg(_scale_lock);
+      for(std::size_t x = 0; x < _elastic.min; ++x) {
+        _spawn();
+      }
+    }
+
+    if(_elastic.max > _elastic.min) {
+      _monitor = thread_factory<Thread>::spawn(_policy, [this]() {
+        _watch();
+      });
     }
   }
 
@@ -36,8 +122,90 @@ public:
   template<class Function, class... Args>
   auto push(Function && newTask, Args &&... args) {
     auto future = TaskPool::push(std::forward<Function>(newTask), std::forward<Args>(args)...);
-    
-    _cv.notify_one();
+
+    _wake();
+    return future;
+  }
+
+  template<class Function, class... Args>
+  int post(Function && newTask, Args &&... args) {
+    int result = TaskPool::post(std::forward<Function>(newTask), std::forward<Args>(args)...);
+
+    _wake();
+    return result;
+  }
+
+  /**
+   * Like post for every task, the queue is locked and the workers are woken once per batch
+   *
+   * @return -1 if any task was rejected, err::code is set to err::OVERLOADED
+   */
+  template<class Function>
+  int postBatch(std::vector<Function> &&tasks) {
+    std::size_t rejected = 0;
+
+    auto first = std::begin(tasks);
+    while(first != std::end(tasks)) {
+      auto next = TaskPool::postRange(first, std::end(tasks), rejected);
+
+      if(next - first > 1) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        _event.notify_all();
+        _notify_monitor();
+        _grow();
+      }
+      else if(next != first) {
+        _wake();
+      }
+
+      // The queue is full, wait for capacity the way post does
+      if(next != std::end(tasks)) {
+        rejected += post(std::move(*next)) ? 1 : 0;
+        ++next;
+      }
+
+      first = next;
+    }
+
+    if(rejected) {
+      err::code = err::OVERLOADED;
+      return -1;
+    }
+
+    return 0;
+  }
+
+  template<class Function, class... Args>
+  auto pushLane(Function && newTask, lane_t lane, Args &&... args) {
+    auto future = TaskPool::pushLane(std::forward<Function>(newTask), lane, std::forward<Args>(args)...);
+
+    _wake();
+    return future;
+  }
+
+  template<class Function, class Deadline, class... Args>
+  auto pushDeadline(Function && newTask, lane_t lane, Deadline deadline, Args &&... args) {
+    auto future = TaskPool::pushDeadline(std::forward<Function>(newTask), lane, deadline, std::forward<Args>(args)...);
+
+    _wake();
+    return future;
+  }
+
+  template<class Function, class... Args>
+  auto pushStoppable(Function && newTask, StopToken token, Args &&... args) {
+    auto future = TaskPool::pushStoppable(std::forward<Function>(newTask), std::move(token), std::forward<Args>(args)...);
+
+    _wake();
+    return future;
+  }
+
+  template<class Function, class X, class Y, class... Args>
+  auto pushDelayedStoppable(Function &&newTask, std::chrono::duration<X, Y> duration, StopToken token, Args &&... args) {
+    auto future = TaskPool::pushDelayedStoppable(std::forward<Function>(newTask), duration, std::move(token), std::forward<Args>(args)...);
+
+    // Update all timers for wait_until
+    _event.notify_all();
     return future;
   }
 
@@ -46,34 +214,97 @@ public:
     auto future = TaskPool::pushDelayed(std::forward<Function>(newTask), duration, std::forward<Args>(args)...);
 
     // Update all timers for wait_until
-    _cv.notify_all();
+    _event.notify_all();
     return future;
   }
-  
+
   void join() {
     if (!_continue.exchange(false)) return;
-    
-    _cv.notify_all();
-    for (auto & t : _thread) {
-      t.join();
+
+    _event.notify_all();
+    _overdue.notify_all();
+
+    if(_monitor.joinable()) {
+      _monitor.join();
+    }
+
+    // Retiring workers take _scale_lock, don't hold it while joining them
+    std::vector<Thread> threads;
+    {
+      std::lock_guard<std::mutex> lg(_scale_lock);
+      threads = std::move(_thread);
+    }
+
+    for (auto & t : threads) {
+      if(t.joinable()) {
+        t.join();
+      }
     }
   }
 
+  // Number of workers parked in _main
+  std::uint32_t idle() const {
+    return _event.waiters();
+  }
+
+  worker_stats_t worker_stats() const {
+    return worker_stats_t {
+      _live.load(),
+      _event.waiters(),
+      _grown.load(),
+      _retired.load()
+    };
+  }
+
 public:
 
-  void _main() {
-    while (_continue.load()) {
+  void _main(std::size_t index) {
+    apply_thread_policy(_policy, index);
+
+    // On the stack of the worker, so it's on the worker's own NUMA node
+    std::uint32_t spin_budget = SPIN_MIN;
+
+    auto idle_since = std::chrono::steady_clock::now();
+
+    while (_continue.load(std::memory_order_relaxed)) {
       if(auto task = this->pop()) {
         (*task)->run();
+
+        _grow();
+        idle_since = std::chrono::steady_clock::now();
+        continue;
+      }
+
+      if(_spin(spin_budget)) {
+        continue;
+      }
+
+      auto key = _event.prepare_wait();
+
+      // A task pushed before prepare_wait() is visible here, one pushed after bumps the key
+      if(!_continue.load() || this->ready()) {
+        _event.cancel_wait();
+
+        continue;
+      }
+
+      auto tp = next();
+
+      bool elastic = _live.load() > _elastic.min;
+      auto retire_at = idle_since + _elastic.keep_alive;
+      if(elastic && (!tp || retire_at < *tp)) {
+        tp = retire_at;
+      }
+
+      if(tp) {
+        _event.wait_until(key, *tp);
       }
       else {
-        std::unique_lock<std::mutex> uniq_lock(_lock);
-        if(auto tp = next()) {
-          _cv.wait_until(uniq_lock, *tp);
-        }
-        else {
-          _cv.wait(uniq_lock);
-        }
+        _event.wait(key);
+      }
+
+      if(elastic && std::chrono::steady_clock::now() >= retire_at && _retire(index)) {
+        return;
       }
     }
 
@@ -82,8 +313,197 @@ public:
       (*task)->run();
     }
   }
+
+private:
+  void _wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    _notify_monitor();
+
+    // A spinning worker will pick up the task
+    if(_spinning.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    _event.notify_one();
+    _grow();
+  }
+
+  // Add a worker if tasks have been waiting for too long
+  void _grow() {
+    // Cheap checks first, oldest() takes the task lock
+    if(
+      _live.load(std::memory_order_relaxed) >= _elastic.max ||
+      !this->pending() ||
+      _event.waiters() ||
+      _spinning.load(std::memory_order_relaxed)
+    ) {
+      return;
+    }
+
+    auto oldest = this->oldest();
+    if(!oldest || std::chrono::steady_clock::now() - *oldest < _elastic.threshold) {
+      return;
+    }
+
+    if(_growing.exchange(true)) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lg(_scale_lock);
+
+      if(_continue.load() && _live.load() < _elastic.max) {
+        _spawn();
+        ++_grown;
+      }
+    }
+
+    _growing.store(false);
+  }
+
+  // Requires a seq_cst fence after the push
+  void _notify_monitor() {
+    if(_monitor_idle.load(std::memory_order_relaxed)) {
+      _overdue.notify_one();
+    }
+  }
+
+  /*
+   * The workers check the queueing delay when tasks are pushed or finished,
+   * with all of them blocked in long tasks the monitor is left to notice tasks going overdue.
+   */
+  void _watch() {
+    // A new worker needs a moment to take the oldest task, don't count it as overdue again right away
+    auto not_before = std::chrono::steady_clock::now();
+
+    while(_continue.load()) {
+      auto key = _overdue.prepare_wait();
+
+      _monitor_idle.store(true);
+
+      // Pairs with the fence in _wake(), either the push is seen here or the push sees _monitor_idle
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      auto oldest = this->oldest();
+      if(!_continue.load()) {
+        _overdue.cancel_wait();
+        break;
+      }
+
+      if(!oldest || _live.load() >= _elastic.max) {
+        _overdue.wait(key);
+        _monitor_idle.store(false);
+
+        continue;
+      }
+
+      _monitor_idle.store(false);
+      _overdue.wait_until(key, std::max(*oldest + _elastic.threshold, not_before));
+
+      _grow();
+      not_before = std::chrono::steady_clock::now() + _elastic.threshold;
+    }
+  }
+
+  // @return true if the worker must exit
+  bool _retire(std::size_t index) {
+    auto live = _live.load();
+    do {
+      if(live <= _elastic.min) {
+        return false;
+      }
+    } while(!_live.compare_exchange_weak(live, live - 1));
+
+    // A push may have landed while no other worker was awake to see it
+    if(this->ready() || !_continue.load()) {
+      ++_live;
+
+      return false;
+    }
+
+    ++_retired;
+
+    std::lock_guard<std::mutex> lg(_scale_lock);
+    _free.push_back(index);
+
+    return true;
+  }
+
+  // Requires _scale_lock
+  void _spawn() {
+    std::size_t index;
+    if(_free.empty()) {
+      index = _used++;
+    }
+    else {
+      index = _free.back();
+      _free.pop_back();
+
+      // The retired worker is past its last use of the slot
+      _thread[index].join();
+    }
+
+    ++_live;
+    _thread[index] = thread_factory<Thread>::spawn(_policy, [this, index]() {
+      _main(index);
+    });
+  }
+
+  /*
+   * Poll for new tasks before parking.
+   * The budget doubles when polling pays off and halves when it doesn't.
+   *
+   * @return true if a task became ready
+   */
+  bool _spin(std::uint32_t &budget) {
+    if(_spinning.fetch_add(1, std::memory_order_relaxed) >= _max_spinning) {
+      _spinning.fetch_sub(1, std::memory_order_relaxed);
+
+      return false;
+    }
+
+    bool found = false;
+    for(std::uint32_t x = 0; x < budget && _continue.load(std::memory_order_relaxed); ++x) {
+      if(this->pending()) {
+        found = true;
+
+        break;
+      }
+
+      _cpu_relax();
+    }
+
+    _spinning.fetch_sub(1, std::memory_order_relaxed);
+
+    if(found) {
+      budget = std::min(budget * 2, SPIN_MAX);
+
+      // Pushes skipped notifying while this worker was spinning, more tasks may be waiting
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(this->pending() > 1) {
+        _event.notify_one();
+      }
+    }
+    else {
+      budget = std::max(budget / 2, SPIN_MIN);
+    }
+
+    return found;
+  }
+
+  static void _cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+  }
 };
 
-typedef ThreadPoolWith<thread_t> ThreadPool;
+// Unlike std::thread, native_thread_t honors thread_policy_t::stack_size
+typedef ThreadPoolWith<native_thread_t> ThreadPool;
 }
 #endif
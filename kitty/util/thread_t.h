@@ -26,52 +26,66 @@ public:
   }
 };
 }
-//////////////////////////////////////////////////////////////////////////////////////////////////////
-#ifndef LACKS_FEATURE_THREAD
-namespace util {
-typedef std::thread thread_t;
-}
-#else
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 /*
  * Calling join() on std::thread causes a pure virtual function call
  * For this reason, I constructed a drop-in replacement for std::thread.
  * It contains a subset of std::thread
+ *
+ * Unlike std::thread, it can be given the attributes of the new thread.
  */
 #include <pthread.h>
 #include <memory>
+#include <functional>
+#include <type_traits>
 #include <system_error>
 #include <kitty/err/err.h>
 
-class thread_t {
+namespace util {
+class native_thread_t {
   pthread_t _id;
 
-  typedef std::unique_ptr<_ImplBase> _Runnable;
 public:
+  struct attr_t {
+    // 0 keeps the default stack size
+    std::size_t stack_size;
+  };
 
-  thread_t() : _id(0) { }
+  native_thread_t() : _id(0) { }
 
-  thread_t(thread_t &&other) {
+  native_thread_t(native_thread_t &&other) : _id(0) {
     std::swap(this->_id, other._id);
   }
 
-  void operator=(thread_t &&other) {
+  native_thread_t &operator=(native_thread_t &&other) {
     std::swap(this->_id, other._id);
+
+    return *this;
+  }
+
+  template<class Function, class... Args, class = std::enable_if_t<
+    !std::is_same<std::decay_t<Function>, attr_t>::value && !std::is_same<std::decay_t<Function>, native_thread_t>::value
+  >>
+  explicit native_thread_t(Function&& f, Args&&... args) : _id(0) {
+    _startThread(attr_t { 0 }, std::bind(
+      std::forward<Function>(f),
+      std::forward<Args>(args)...
+      )
+    );
   }
 
   template<class Function, class... Args>
-  explicit thread_t(Function&& f, Args&&... args) : _id(0) {
-    _startThread(std::bind(
+  native_thread_t(const attr_t &attr, Function&& f, Args&&... args) : _id(0) {
+    _startThread(attr, std::bind(
       std::forward<Function>(f),
       std::forward<Args>(args)...
       )
     );
   }
 
-  thread_t(const thread_t&) = delete;
+  native_thread_t(const native_thread_t&) = delete;
 
-  ~thread_t() {
+  ~native_thread_t() {
     if(joinable()) std::terminate();
   }
 
@@ -84,15 +98,18 @@ public:
     }
   }
 
-  bool joinable() {
+  bool joinable() const {
     return _id != 0;
   }
 
+  pthread_t native_handle() const {
+    return _id;
+  }
+
 private:
 
-  static void *_main(_ImplBase *task) {
-    thread_t::_Runnable _task(task);
-    //auto callBack = std::move(_this->_callBack);
+  static void *_main(void *task) {
+    std::unique_ptr<_ImplBase> _task(static_cast<_ImplBase*>(task));
 
     _task->run();
 
@@ -100,19 +117,38 @@ private:
   }
 
   template<class Function>
-  void _startThread(Function&& callBack) {
-    _ImplBase *task = new _Impl<Function>(std::forward<Function>(callBack));
-
-    if(pthread_create(
-       &_id,
-       nullptr,
-       reinterpret_cast<void *(*)(void *)>(&thread_t::_main),
-       task
-       )) {
-      throw std::system_error(errno, std::system_category());
+  void _startThread(const attr_t &attr, Function&& callBack) {
+    auto task = std::make_unique<_Impl<Function>>(std::forward<Function>(callBack));
+
+    pthread_attr_t pattr;
+    pthread_attr_init(&pattr);
+
+    if(attr.stack_size) {
+      // Fails if below PTHREAD_STACK_MIN, the default is kept in that case
+      pthread_attr_setstacksize(&pattr, attr.stack_size);
+    }
+
+    // Through the base, _main converts it back to _ImplBase*
+    int err = pthread_create(&_id, &pattr, &native_thread_t::_main, static_cast<_ImplBase*>(task.get()));
+    pthread_attr_destroy(&pattr);
+
+    if(err) {
+      _id = 0;
+      throw std::system_error(err, std::system_category());
     }
+
+    task.release();
   }
 };
 }
+
+#ifndef LACKS_FEATURE_THREAD
+namespace util {
+typedef std::thread thread_t;
+}
+#else
+namespace util {
+typedef native_thread_t thread_t;
+}
 #endif
 #endif
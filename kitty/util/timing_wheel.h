@@ -0,0 +1,282 @@
+#ifndef KITTY_UTIL_TIMING_WHEEL_H
+#define KITTY_UTIL_TIMING_WHEEL_H
+
+#include <array>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+/*
+ * A hierarchical timing wheel: 4 levels of 64 slots, each level 64 times coarser than the one below.
+ * Arming, re-arming and cancelling an entry is O(1), expired entries are handed out in bulk by advance().
+ * Time is counted in ticks, the owner decides how long a tick is.
+ * Deadlines more than 64^4 ticks away are kept in the last level until they come within range.
+ *
+ * The entries are intrusive, the wheel doesn't allocate. It isn't thread safe.
+ *
+ * util::TimingWheel<connection_t*> wheel;
+ * connection->idle.data = connection;
+ *
+ * wheel.arm(connection->idle, wheel.now() + 30000); // again on every read
+ * wheel.advance(ms_since_start, [](auto &entry) { entry.data->close(); });
+ */
+namespace util {
+namespace _timing_wheel {
+struct link_t {
+  link_t *prev;
+  link_t *next;
+
+  void unlink() {
+    prev->next = next;
+    next->prev = prev;
+
+    prev = next = nullptr;
+  }
+
+  // Insert node before this
+  void push_back(link_t &node) {
+    node.prev = prev;
+    node.next = this;
+
+    prev->next = &node;
+    prev = &node;
+  }
+
+  bool empty() const { return next == this; }
+
+  void reset() { prev = next = this; }
+
+  // Move all nodes of this list to head, leaving this empty
+  void splice_to(link_t &head) {
+    if(empty()) {
+      head.reset();
+      return;
+    }
+
+    head.next = next;
+    head.prev = prev;
+    next->prev = &head;
+    prev->next = &head;
+
+    reset();
+  }
+};
+}
+
+template<class T>
+class TimingWheel {
+public:
+  typedef std::uint64_t tick_t;
+
+  static constexpr std::size_t BITS   = 6;
+  static constexpr std::size_t SLOTS  = 1 << BITS;
+  static constexpr std::size_t LEVELS = 4;
+
+  // The furthest a deadline can be placed, later deadlines are clamped and placed again later
+  static constexpr tick_t SPAN = (tick_t)1 << (BITS * LEVELS);
+
+  class entry_t : _timing_wheel::link_t {
+    friend class TimingWheel;
+
+    TimingWheel *_wheel = nullptr;
+    tick_t _expires = 0;
+
+  public:
+    T data;
+
+    entry_t() : link_t { nullptr, nullptr }, data() {}
+    explicit entry_t(T data) : link_t { nullptr, nullptr }, data(std::move(data)) {}
+
+    entry_t(const entry_t&) = delete;
+    entry_t &operator=(const entry_t&) = delete;
+
+    ~entry_t() {
+      if(armed()) {
+        _wheel->cancel(*this);
+      }
+    }
+
+    bool armed() const { return next; }
+
+    // Only meaningful while armed
+    tick_t expires() const { return _expires; }
+  };
+
+private:
+  static constexpr tick_t MASK = SLOTS - 1;
+
+  std::array<std::array<_timing_wheel::link_t, SLOTS>, LEVELS> _slots;
+
+  tick_t _now;
+  std::size_t _size;
+
+public:
+  explicit TimingWheel(tick_t now = 0) : _now(now), _size(0) {
+    for(auto &level : _slots) {
+      for(auto &slot : level) {
+        slot.reset();
+      }
+    }
+  }
+
+  TimingWheel(const TimingWheel&) = delete;
+  TimingWheel &operator=(const TimingWheel&) = delete;
+
+  ~TimingWheel() {
+    for(auto &level : _slots) {
+      for(auto &slot : level) {
+        while(!slot.empty()) {
+          cancel(static_cast<entry_t&>(*slot.next));
+        }
+      }
+    }
+  }
+
+  /*
+   * (Re)arm entry to expire once the wheel advances to expires.
+   * Deadlines that have already passed expire on the next tick.
+   */
+  void arm(entry_t &entry, tick_t expires) {
+    if(entry.armed()) {
+      entry.unlink();
+    }
+    else {
+      entry._wheel = this;
+      ++_size;
+    }
+
+    entry._expires = expires;
+    _link(entry, _now + 1);
+  }
+
+  void cancel(entry_t &entry) {
+    if(!entry.armed()) {
+      return;
+    }
+
+    entry.unlink();
+    --_size;
+  }
+
+  /*
+   * Move the wheel forward to now and call on_expire(entry_t&) for every entry that expired.
+   * on_expire may arm and cancel any entry, including the ones that are about to expire.
+   *
+   * @return The number of expired entries
+   */
+  template<class F>
+  std::size_t advance(tick_t now, F &&on_expire) {
+    std::size_t expired = 0;
+
+    while(_now < now) {
+      // Skip empty slots, but stop for a cascade
+      do {
+        ++_now;
+      } while(_now < now && (_now & MASK) && _slots[0][_now & MASK].empty());
+
+      expired += _tick(on_expire);
+    }
+
+    return expired;
+  }
+
+  /*
+   * @return The number of ticks until advance() has work to do, a lower bound on the next expiry.
+   *         std::numeric_limits<tick_t>::max() when nothing is armed
+   */
+  tick_t next() const {
+    if(!_size) {
+      return std::numeric_limits<tick_t>::max();
+    }
+
+    auto next = std::numeric_limits<tick_t>::max();
+    for(std::size_t level = 0; level < LEVELS; ++level) {
+      auto shift = BITS * level;
+      auto index = _now >> shift;
+
+      for(tick_t x = 1; x <= SLOTS; ++x) {
+        if(!_slots[level][(index + x) & MASK].empty()) {
+          // For the higher levels, that's when the slot is cascaded
+          next = std::min(next, ((index + x) << shift) - _now);
+          break;
+        }
+      }
+    }
+
+    return next;
+  }
+
+  tick_t now() const { return _now; }
+
+  // The number of armed entries
+  std::size_t size() const { return _size; }
+
+private:
+  void _link(entry_t &entry, tick_t earliest) {
+    auto expires = std::max(entry._expires, earliest);
+    if(expires - _now >= SPAN) {
+      expires = _now + SPAN - 1;
+    }
+
+    auto delta = expires - _now;
+
+    std::size_t level = 0;
+    while(level + 1 < LEVELS && delta >= (tick_t)1 << (BITS * (level + 1))) {
+      ++level;
+    }
+
+    _slots[level][(expires >> (BITS * level)) & MASK].push_back(entry);
+  }
+
+  // Place the entries of a slot again, now that they're closer
+  void _cascade(std::size_t level, std::size_t index) {
+    _timing_wheel::link_t pending;
+    _slots[level][index].splice_to(pending);
+
+    while(!pending.empty()) {
+      auto &entry = static_cast<entry_t&>(*pending.next);
+
+      entry.unlink();
+      _link(entry, _now);
+    }
+  }
+
+  template<class F>
+  std::size_t _tick(F &on_expire) {
+    for(std::size_t level = 1; level < LEVELS; ++level) {
+      if((_now >> (BITS * (level - 1))) & MASK) {
+        break;
+      }
+
+      _cascade(level, (_now >> (BITS * level)) & MASK);
+    }
+
+    // Detached first, so on_expire can arm entries for the next tick
+    _timing_wheel::link_t expired;
+    _slots[0][_now & MASK].splice_to(expired);
+
+    std::size_t count = 0;
+    while(!expired.empty()) {
+      auto &entry = static_cast<entry_t&>(*expired.next);
+
+      // Clamped deadlines that are still far away
+      if(entry._expires > _now) {
+        entry.unlink();
+        _link(entry, _now + 1);
+
+        continue;
+      }
+
+      entry.unlink();
+      --_size;
+
+      ++count;
+      on_expire(entry);
+    }
+
+    return count;
+  }
+};
+}
+#endif
@@ -0,0 +1,315 @@
+#ifndef KITTY_UTIL_TOKENIZER_H
+#define KITTY_UTIL_TOKENIZER_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Split strings into pieces that point into the source string.
+ * Empty pieces, between adjacent delimiters, are skipped.
+ *
+ * for(auto word : util::tokenize(line, ' ')) { ... }
+ * for(auto word : util::tokenize(line, util::any_of(" \t\r\n"))) { ... }
+ *
+ * The source string must outlive the pieces.
+ */
+namespace util {
+namespace delim {
+// A single delimiter, memchr is vectorized by the C library
+struct single_t {
+  char delim;
+
+  // @return The position of the first delimiter at or after pos, or str.size()
+  std::size_t find(std::string_view str, std::size_t pos) const {
+    auto found = (const char*)std::memchr(str.data() + pos, delim, str.size() - pos);
+
+    return found ? found - str.data() : str.size();
+  }
+};
+
+/*
+ * Any of a set of delimiters
+ * Up to MAX_SIMD delimiters are compared 16 or 32 bytes at a time when SSE2 or AVX2 is available,
+ * larger sets fall back to a lookup table.
+ */
+class any_of_t {
+public:
+  static constexpr std::size_t MAX_SIMD = 8;
+
+private:
+  std::array<bool, 256> _table {};
+
+  std::array<char, MAX_SIMD> _delims {};
+  std::size_t _count = 0;
+
+public:
+  explicit any_of_t(std::string_view delims) {
+    for(auto ch : delims) {
+      auto &entry = _table[(std::uint8_t)ch];
+
+      if(!entry && _count < _delims.size()) {
+        _delims[_count] = ch;
+      }
+
+      // Counts beyond MAX_SIMD to tell a large set apart
+      _count += !entry;
+      entry = true;
+    }
+  }
+
+  bool contains(char ch) const {
+    return _table[(std::uint8_t)ch];
+  }
+
+  std::size_t find(std::string_view str, std::size_t pos) const {
+#if defined(__AVX2__) || defined(__SSE2__)
+    if(_count <= MAX_SIMD) {
+      pos = _find_simd(str, pos);
+    }
+#endif
+
+    for(; pos < str.size(); ++pos) {
+      if(contains(str[pos])) {
+        return pos;
+      }
+    }
+
+    return str.size();
+  }
+
+private:
+#if defined(__AVX2__) || defined(__SSE2__)
+  /*
+   * @return The position of the first delimiter in the whole blocks after pos,
+   * or the position from which the remainder must be searched byte by byte
+   */
+  std::size_t _find_simd(std::string_view str, std::size_t pos) const {
+    auto data = str.data();
+
+#ifdef __AVX2__
+    for(; pos + 32 <= str.size(); pos += 32) {
+      auto block = _mm256_loadu_si256((const __m256i*)(data + pos));
+
+      auto match = _mm256_setzero_si256();
+      for(std::size_t x = 0; x < _count; ++x) {
+        match = _mm256_or_si256(match, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(_delims[x])));
+      }
+
+      if(auto mask = (std::uint32_t)_mm256_movemask_epi8(match)) {
+        return pos + __builtin_ctz(mask);
+      }
+    }
+#endif
+
+    for(; pos + 16 <= str.size(); pos += 16) {
+      auto block = _mm_loadu_si128((const __m128i*)(data + pos));
+
+      auto match = _mm_setzero_si128();
+      for(std::size_t x = 0; x < _count; ++x) {
+        match = _mm_or_si128(match, _mm_cmpeq_epi8(block, _mm_set1_epi8(_delims[x])));
+      }
+
+      if(auto mask = (std::uint32_t)_mm_movemask_epi8(match)) {
+        return pos + __builtin_ctz(mask);
+      }
+    }
+
+    return pos;
+  }
+#endif
+};
+}
+
+/*
+ * Lazily splits a string, a piece is only searched for when it's asked for.
+ * Besides iterating, next() consumes the pieces one by one and rest() holds what hasn't been consumed.
+ * When streaming, next_terminated() only consumes pieces followed by a delimiter,
+ * so rest() holds the partial line that needs more input.
+ */
+template<class Delim>
+class Tokenizer {
+  std::string_view _str;
+  Delim _delim;
+
+  // Where the search for the next piece starts
+  std::size_t _pos;
+
+public:
+  class iterator {
+    friend class Tokenizer;
+
+    const Tokenizer *_tokenizer;
+    std::size_t _pos;
+    std::string_view _piece;
+
+    iterator(const Tokenizer *tokenizer, std::size_t pos) : _tokenizer(tokenizer), _pos(pos) {
+      _advance();
+    }
+
+    void _advance() {
+      if(!_tokenizer) {
+        return;
+      }
+
+      auto piece = _tokenizer->_next(_pos);
+      if(!piece) {
+        _tokenizer = nullptr;
+
+        return;
+      }
+
+      _piece = *piece;
+    }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::string_view value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const std::string_view* pointer;
+    typedef const std::string_view& reference;
+
+    iterator() : _tokenizer(nullptr), _pos(0) {}
+
+    reference operator*() const { return _piece; }
+    pointer operator->() const { return &_piece; }
+
+    iterator &operator++() {
+      _advance();
+
+      return *this;
+    }
+
+    iterator operator++(int) {
+      auto it = *this;
+      _advance();
+
+      return it;
+    }
+
+    bool operator==(const iterator &other) const {
+      if(!_tokenizer || !other._tokenizer) {
+        return _tokenizer == other._tokenizer;
+      }
+
+      return _pos == other._pos;
+    }
+
+    bool operator!=(const iterator &other) const {
+      return !(*this == other);
+    }
+  };
+
+  Tokenizer(std::string_view str, Delim delim) : _str(str), _delim(std::move(delim)), _pos(0) {}
+
+  // Iterates over the pieces that haven't been consumed by next()
+  iterator begin() const { return iterator(this, _pos); }
+  iterator end() const { return iterator(); }
+
+  // @return The next piece, or nothing once the string is exhausted, the unterminated tail included
+  std::optional<std::string_view> next() {
+    return _next(_pos);
+  }
+
+  // @return The next piece followed by a delimiter, or nothing once only the unterminated tail is left
+  std::optional<std::string_view> next_terminated() {
+    while(_pos < _str.size()) {
+      auto found = _delim.find(_str, _pos);
+      if(found == _str.size()) {
+        break;
+      }
+
+      auto piece = _str.substr(_pos, found - _pos);
+      _pos = found + 1;
+
+      if(!piece.empty()) {
+        return piece;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  // The part of the string that next() hasn't reached yet
+  std::string_view rest() const {
+    return _str.substr(std::min(_pos, _str.size()));
+  }
+
+private:
+  std::optional<std::string_view> _next(std::size_t &pos) const {
+    while(pos < _str.size()) {
+      auto found = _delim.find(_str, pos);
+
+      auto piece = _str.substr(pos, found - pos);
+      pos = found + 1;
+
+      if(!piece.empty()) {
+        return piece;
+      }
+    }
+
+    return std::nullopt;
+  }
+};
+
+inline delim::any_of_t any_of(std::string_view delims) {
+  return delim::any_of_t { delims };
+}
+
+inline Tokenizer<delim::single_t> tokenize(std::string_view str, char delim) {
+  return { str, delim::single_t { delim } };
+}
+
+template<class Delim>
+Tokenizer<Delim> tokenize(std::string_view str, Delim delim) {
+  return { str, std::move(delim) };
+}
+
+/*
+ * Split str into out, out is cleared first, its capacity is reused
+ * @return The number of pieces
+ */
+template<class Delim>
+std::size_t split_into(std::string_view str, Delim &&delim, std::vector<std::string_view> &out) {
+  out.clear();
+
+  for(auto piece : tokenize(str, std::forward<Delim>(delim))) {
+    out.emplace_back(piece);
+  }
+
+  return out.size();
+}
+
+/*
+ * Split str into owned pieces, the strings already in out are overwritten to reuse their memory
+ * @return The number of pieces
+ */
+template<class Delim>
+std::size_t split_into(std::string_view str, Delim &&delim, std::vector<std::string> &out) {
+  std::size_t count = 0;
+
+  for(auto piece : tokenize(str, std::forward<Delim>(delim))) {
+    if(count < out.size()) {
+      out[count].assign(piece.data(), piece.size());
+    }
+    else {
+      out.emplace_back(piece);
+    }
+
+    ++count;
+  }
+
+  out.resize(count);
+  return count;
+}
+}
+#endif
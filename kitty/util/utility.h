@@ -6,6 +6,7 @@
 #include <type_traits>
 #include <algorithm>
 #include <optional>
+#include <cstdint>
 
 #include <kitty/util/optional.h>
 #include <kitty/err/err.h>
@@ -195,6 +196,36 @@ struct endianness {
   };
 };
 
+/*
+ * Reverses the bytes of x.
+ * Integral and enum types use __builtin_bswap and can be evaluated at compile time,
+ * other types, e.g. a 128 bit uuid, are reversed byte by byte.
+ */
+template<class T>
+constexpr T swap(T x) {
+  static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be byte-swapped");
+
+  if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+    if constexpr (sizeof(T) == 1) {
+      return x;
+    }
+    else if constexpr (sizeof(T) == 2) {
+      return static_cast<T>(__builtin_bswap16(static_cast<std::uint16_t>(x)));
+    }
+    else if constexpr (sizeof(T) == 4) {
+      return static_cast<T>(__builtin_bswap32(static_cast<std::uint32_t>(x)));
+    }
+    else if constexpr (sizeof(T) == 8) {
+      return static_cast<T>(__builtin_bswap64(static_cast<std::uint64_t>(x)));
+    }
+  }
+
+  std::uint8_t *data = reinterpret_cast<std::uint8_t*>(&x);
+  std::reverse(data, data + sizeof(x));
+
+  return x;
+}
+
 template<class T, class S = void>
 struct endian_helper { };
 
@@ -202,21 +233,17 @@ template<class T>
 struct endian_helper<T, std::enable_if_t<
   !(instantiation_of<std::optional, T>::value || instantiation_of<Optional, T>::value)
 >> {
-  static inline T big(T x) {
+  static constexpr T big(T x) {
     if constexpr (endianness<T>::little) {
-      uint8_t *data = reinterpret_cast<uint8_t*>(&x);
-
-      std::reverse(data, data + sizeof(x));
+      return swap(x);
     }
 
     return x;
   }
 
-  static inline T little(T x) {
+  static constexpr T little(T x) {
     if constexpr (endianness<T>::big) {
-      uint8_t *data = reinterpret_cast<uint8_t*>(&x);
-
-      std::reverse(data, data + sizeof(x));
+      return swap(x);
     }
 
     return x;
@@ -231,9 +258,7 @@ struct endian_helper<T, std::enable_if_t<
     if(!x) return x;
 
     if constexpr (endianness<T>::big) {
-      auto *data = reinterpret_cast<uint8_t*>(&*x);
-
-      std::reverse(data, data + sizeof(*x));
+      *x = swap(*x);
     }
 
     return x;
@@ -242,10 +267,8 @@ struct endian_helper<T, std::enable_if_t<
   static inline T big(T x) {
     if(!x) return x;
 
-    if constexpr (endianness<T>::big) {
-      auto *data = reinterpret_cast<uint8_t*>(&*x);
-
-      std::reverse(data, data + sizeof(*x));
+    if constexpr (endianness<T>::little) {
+      *x = swap(*x);
     }
 
     return x;
@@ -253,10 +276,10 @@ struct endian_helper<T, std::enable_if_t<
 };
 
 template<class T>
-inline auto little(T x) { return endian_helper<T>::little(x); }
+constexpr auto little(T x) { return endian_helper<T>::little(x); }
 
 template<class T>
-inline auto big(T x) { return endian_helper<T>::big(x); }
+constexpr auto big(T x) { return endian_helper<T>::big(x); }
 } /* endian */
 
 } /* util */
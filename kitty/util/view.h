@@ -0,0 +1,345 @@
+#ifndef KITTY_UTIL_VIEW_H
+#define KITTY_UTIL_VIEW_H
+
+#include <vector>
+#include <iterator>
+#include <optional>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Lazy ranges that are evaluated in a single pass.
+ *
+ * auto names = util::view::from(users)
+ *   .filter([](const user_t &user) { return user.active; })
+ *   .map([](const user_t &user) { return user.name; })
+ *   .take(10)
+ *   .to_vector();
+ *
+ * No element is touched until to_vector(), collect() or for_each() is called,
+ * every step is then applied to an element before the next element is read.
+ *
+ * A view holds iterators into the container it came from, the container must outlive it.
+ */
+namespace util {
+namespace view {
+template<class View, class Function>
+class map_t;
+
+template<class View, class Function>
+class filter_t;
+
+template<class View>
+class take_t;
+
+template<class View>
+class chunk_t;
+
+template<class First, class Second>
+class concat_t;
+
+/*
+ * The operations shared by all views.
+ *
+ * A view implements:
+ *   typedef ... reference; // The type of the elements handed to a sink
+ *
+ *   // Calls sink with every element, until sink returns false
+ *   // @return false if sink stopped the view
+ *   template<class Sink> bool each(Sink &&sink);
+ *
+ *   // The exact number of elements, if known without evaluating the view
+ *   std::optional<std::size_t> size_hint() const;
+ */
+template<class Derived>
+class view_t {
+public:
+  template<class Function>
+  map_t<Derived, std::decay_t<Function>> map(Function &&f) const {
+    return { _this(), std::forward<Function>(f) };
+  }
+
+  // Keep only the elements for which f returns true
+  template<class Function>
+  filter_t<Derived, std::decay_t<Function>> filter(Function &&f) const {
+    return { _this(), std::forward<Function>(f) };
+  }
+
+  // The first count elements, the remaining elements are never read
+  take_t<Derived> take(std::size_t count) const {
+    return { _this(), count };
+  }
+
+  // Groups of size elements as std::vector, the last group may be smaller
+  chunk_t<Derived> chunk(std::size_t size) const {
+    return { _this(), std::max<std::size_t>(1, size) };
+  }
+
+  // The elements of this view followed by those of other
+  template<class Other>
+  concat_t<Derived, Other> concat(const Other &other) const {
+    return { _this(), other };
+  }
+
+  template<class Function>
+  void for_each(Function &&f) {
+    _this().each([&](auto &&elem) {
+      f(std::forward<decltype(elem)>(elem));
+
+      return true;
+    });
+  }
+
+  template<class Container>
+  Container collect() {
+    Container result;
+
+    if constexpr (_has_reserve<Container>::value) {
+      if(auto size = _this().size_hint()) {
+        result.reserve(*size);
+      }
+    }
+
+    _this().each([&](auto &&elem) {
+      result.insert(std::end(result), std::forward<decltype(elem)>(elem));
+
+      return true;
+    });
+
+    return result;
+  }
+
+  auto to_vector() {
+    return collect<std::vector<std::decay_t<typename Derived::reference>>>();
+  }
+
+private:
+  template<class Container, class = void>
+  struct _has_reserve : std::false_type {};
+
+  template<class Container>
+  struct _has_reserve<Container, std::void_t<decltype(std::declval<Container&>().reserve(0))>> : std::true_type {};
+
+  Derived &_this() { return *static_cast<Derived*>(this); }
+  const Derived &_this() const { return *static_cast<const Derived*>(this); }
+};
+
+template<class It>
+class source_t : public view_t<source_t<It>> {
+  It _begin;
+  It _end;
+
+public:
+  typedef decltype(*std::declval<It&>()) reference;
+
+  source_t(It begin, It end) : _begin(begin), _end(end) {}
+
+  template<class Sink>
+  bool each(Sink &&sink) {
+    for(auto it = _begin; it != _end; ++it) {
+      if(!sink(*it)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  std::optional<std::size_t> size_hint() const {
+    if constexpr (std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value) {
+      return (std::size_t)std::distance(_begin, _end);
+    }
+
+    return std::nullopt;
+  }
+};
+
+template<class View, class Function>
+class map_t : public view_t<map_t<View, Function>> {
+  View _view;
+  Function _f;
+
+public:
+  typedef decltype(std::declval<Function&>()(std::declval<typename View::reference>())) reference;
+
+  map_t(View view, Function f) : _view(std::move(view)), _f(std::move(f)) {}
+
+  template<class Sink>
+  bool each(Sink &&sink) {
+    return _view.each([&](auto &&elem) {
+      return sink(_f(std::forward<decltype(elem)>(elem)));
+    });
+  }
+
+  std::optional<std::size_t> size_hint() const {
+    return _view.size_hint();
+  }
+};
+
+template<class View, class Function>
+class filter_t : public view_t<filter_t<View, Function>> {
+  View _view;
+  Function _f;
+
+public:
+  typedef typename View::reference reference;
+
+  filter_t(View view, Function f) : _view(std::move(view)), _f(std::move(f)) {}
+
+  template<class Sink>
+  bool each(Sink &&sink) {
+    return _view.each([&](auto &&elem) {
+      if(!_f(elem)) {
+        return true;
+      }
+
+      return sink(std::forward<decltype(elem)>(elem));
+    });
+  }
+
+  std::optional<std::size_t> size_hint() const {
+    return std::nullopt;
+  }
+};
+
+template<class View>
+class take_t : public view_t<take_t<View>> {
+  View _view;
+  std::size_t _count;
+
+public:
+  typedef typename View::reference reference;
+
+  take_t(View view, std::size_t count) : _view(std::move(view)), _count(count) {}
+
+  template<class Sink>
+  bool each(Sink &&sink) {
+    if(!_count) {
+      return true;
+    }
+
+    std::size_t taken = 0;
+    bool stopped = false;
+
+    _view.each([&](auto &&elem) {
+      if(!sink(std::forward<decltype(elem)>(elem))) {
+        stopped = true;
+
+        return false;
+      }
+
+      // Stop the view upstream once count is reached
+      return ++taken < _count;
+    });
+
+    return !stopped;
+  }
+
+  std::optional<std::size_t> size_hint() const {
+    auto size = _view.size_hint();
+    if(!size) {
+      return std::nullopt;
+    }
+
+    return std::min(*size, _count);
+  }
+};
+
+template<class View>
+class chunk_t : public view_t<chunk_t<View>> {
+  View _view;
+  std::size_t _size;
+
+public:
+  typedef std::vector<std::decay_t<typename View::reference>> value_type;
+  typedef value_type&& reference;
+
+  chunk_t(View view, std::size_t size) : _view(std::move(view)), _size(size) {}
+
+  template<class Sink>
+  bool each(Sink &&sink) {
+    value_type chunk;
+    chunk.reserve(_size);
+
+    bool result = _view.each([&](auto &&elem) {
+      chunk.emplace_back(std::forward<decltype(elem)>(elem));
+
+      if(chunk.size() < _size) {
+        return true;
+      }
+
+      bool more = sink(std::move(chunk));
+
+      chunk = value_type();
+      chunk.reserve(_size);
+
+      return more;
+    });
+
+    if(result && !chunk.empty()) {
+      return sink(std::move(chunk));
+    }
+
+    return result;
+  }
+
+  std::optional<std::size_t> size_hint() const {
+    auto size = _view.size_hint();
+    if(!size) {
+      return std::nullopt;
+    }
+
+    return (*size + _size - 1) / _size;
+  }
+};
+
+template<class First, class Second>
+class concat_t : public view_t<concat_t<First, Second>> {
+  First _first;
+  Second _second;
+
+public:
+  // Both views must hand out the same type of element, references only if they agree on it
+  typedef std::conditional_t<
+    std::is_same<typename First::reference, typename Second::reference>::value,
+    typename First::reference,
+    std::common_type_t<std::decay_t<typename First::reference>, std::decay_t<typename Second::reference>>
+  > reference;
+
+  concat_t(First first, Second second) : _first(std::move(first)), _second(std::move(second)) {}
+
+  template<class Sink>
+  bool each(Sink &&sink) {
+    return _first.each(sink) && _second.each(sink);
+  }
+
+  std::optional<std::size_t> size_hint() const {
+    auto first  = _first.size_hint();
+    auto second = _second.size_hint();
+
+    if(!first || !second) {
+      return std::nullopt;
+    }
+
+    return *first + *second;
+  }
+};
+
+template<class It>
+source_t<It> from(It begin, It end) {
+  return { begin, end };
+}
+
+template<class Container>
+auto from(Container &container) {
+  return from(std::begin(container), std::end(container));
+}
+
+template<class First, class Second>
+concat_t<First, Second> concat(const First &first, const Second &second) {
+  return { first, second };
+}
+}
+}
+#endif